@@ -0,0 +1,104 @@
+/* 
+ * siapp-sdk
+ *
+ * SPDX-License-Identifier: MIT
+ * Copyright 2020 Siemens AG
+ *
+ */
+
+#include <benchmark.h>
+
+static uint32_t s_read_count = 0;
+static uint32_t s_write_count = 0;
+
+/*!
+******************************************************************************
+DESCRIPTION:     write callback of the loopback server, the values are not used
+*****************************************************************************/
+static void s_server_write_cb(T_EDGE_DATA* event)
+{
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     new client connection at the loopback server
+*****************************************************************************/
+static void s_server_connected(void* fd)
+{
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   T_EDGE_DATA_VALUE value;
+   char topic[32];
+
+   edgedata_callback_with_reply_register(m_fd, MSG_TYPE_DISCOVER, edgedata_flatbuffers_discover_with_reply);
+   edgedata_callback_with_reply_register(m_fd, MSG_TYPE_UPDATE_DATA, edgedata_flatbuffers_edge_event_receive);
+   edgedata_callback_register(m_fd, MSG_TYPE_UPDATE_DATA, edgedata_rpc_dummy_ack);
+   memset(&value, 0, sizeof(value));
+   for (uint32_t i = 0; i < s_read_count; i++)
+   {
+      snprintf(topic, sizeof(topic), "read%u", i);
+      edgedata_data_discover_add(m_fd, topic, BENCHMARK_READ_HANDLE(i), E_EDGE_DATA_TYPE_UINT32, EDGE_SOURCE_FLAG_READ, 0, &value, 0, NULL);
+   }
+   for (uint32_t i = 0; i < s_write_count; i++)
+   {
+      snprintf(topic, sizeof(topic), "write%u", i);
+      edgedata_data_discover_add(m_fd, topic, BENCHMARK_READ_HANDLE(s_read_count + i), E_EDGE_DATA_TYPE_UINT32, EDGE_SOURCE_FLAG_WRITE, 0, &value, 0, s_server_write_cb);
+   }
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     log output of the EdgeDataApi
+*****************************************************************************/
+void benchmark_logger(const char* info)
+{
+   if (info != NULL)
+   {
+      fprintf(stderr, "%s", info);
+   }
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     monotonic time in ns
+*****************************************************************************/
+uint64_t benchmark_now_ns(void)
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     print the duration per operation
+*****************************************************************************/
+void benchmark_print(const char* name, uint64_t duration_ns, uint32_t count)
+{
+   printf("%-40s %10u ops %12.3f us/op\n", name, count, (count > 0) ? ((double)duration_ns / 1000.0 / count) : 0.0);
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     start the in-process loopback server, edge_data_connect() uses it instead of the edge data socket
+*****************************************************************************/
+bool benchmark_server_start(uint32_t read_count, uint32_t write_count)
+{
+   s_read_count = read_count;
+   s_write_count = write_count;
+   edgedata_ipc_loopback_server = edgedata_ipc_loopback_server_create(s_server_connected, NULL);
+   if (edgedata_ipc_loopback_server == NULL)
+   {
+      return false;
+   }
+   edgedata_thread_start_server(edgedata_ipc_loopback_server);
+   return true;
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     stop the loopback server, all its client connections are closed
+*****************************************************************************/
+void benchmark_server_stop(void)
+{
+   edgedata_ipc_server_close(&edgedata_ipc_loopback_server);
+}
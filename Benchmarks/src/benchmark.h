@@ -0,0 +1,22 @@
+/* 
+ * siapp-sdk
+ *
+ * SPDX-License-Identifier: MIT
+ * Copyright 2020 Siemens AG
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <edgedata_internal.h>
+
+/* handles of the loopback server: read values 1..read_count, write values after them */
+#define BENCHMARK_READ_HANDLE(i)        ((uint32_t)(i) + 1)
+
+extern void benchmark_logger(const char* info);
+extern uint64_t benchmark_now_ns(void);
+extern void benchmark_print(const char* name, uint64_t duration_ns, uint32_t count);
+extern bool benchmark_server_start(uint32_t read_count, uint32_t write_count);
+extern void benchmark_server_stop(void);
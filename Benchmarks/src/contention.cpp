@@ -0,0 +1,161 @@
+/* 
+ * siapp-sdk
+ *
+ * SPDX-License-Identifier: MIT
+ * Copyright 2020 Siemens AG
+ *
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <benchmark.h>
+
+#define READ_COUNT      10000
+#define DURATION_US     2000000
+#define TORN_CHECK_STEP 97
+#define EVENT_BATCH     100
+#define EVENTS_IN_FLIGHT 1000
+
+static std::atomic<bool> s_stop(false);
+static uint32_t s_sent = 0;       /* sender thread only */
+static std::atomic<uint64_t> s_reads(0);
+static std::atomic<uint64_t> s_torn(0);
+
+/*!
+******************************************************************************
+DESCRIPTION:     server side: EVENT_BATCH events round robin over all read values,
+                 value, quality and timestamp of an event are equal
+*****************************************************************************/
+static void s_send_events(void* fd, void* context)
+{
+   T_EDGE_DATA_VALUE value;
+   for (uint32_t k = 0; k < EVENT_BATCH; k++)
+   {
+      s_sent++;
+      value.uint32 = s_sent;
+      if (!edgedata_flatbuffers_edge_event_send(fd, BENCHMARK_READ_HANDLE(s_sent % READ_COUNT), E_EDGE_DATA_TYPE_UINT32, s_sent, &value, s_sent))
+      {
+         break;
+      }
+   }
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     sender thread: events until s_stop, at most EVENTS_IN_FLIGHT not received by the application
+                 (the loopback server queues without limit of the stream window and drops a peer which falls behind)
+*****************************************************************************/
+static void s_sender(void)
+{
+   while (!s_stop)
+   {
+      if ((s_sent - __atomic_load_n(&edge_data_fd->stream_received, __ATOMIC_RELAXED)) >= EVENTS_IN_FLIGHT)
+      {
+         sched_yield();
+         continue;
+      }
+      edgedata_ipc_server_broadcast(edgedata_ipc_loopback_server, s_send_events, NULL);
+   }
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     reader thread: edge_data_sync_read() of its own part of the handles,
+                 samples of the copied values are checked for torn copies
+*****************************************************************************/
+static void s_reader(T_EDGE_DATA_HANDLE* handles, uint32_t handles_len)
+{
+   uint64_t reads = 0;
+   while (!s_stop)
+   {
+      if (edge_data_sync_read(handles, handles_len) != E_EDGE_DATA_RETVAL_OK)
+      {
+         break;
+      }
+      reads++;
+      for (uint32_t i = 0; i < handles_len; i += TORN_CHECK_STEP)
+      {
+         T_EDGE_DATA* data = edge_data_get_data(handles[i]);
+         if ((data->value.uint32 != (uint32_t)data->timestamp64) || (data->quality != (uint32_t)data->timestamp64))
+         {
+            s_torn++;
+         }
+      }
+   }
+   s_reads += reads;
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     received events and sync_read calls while reader_count threads read
+*****************************************************************************/
+static bool s_measure(uint32_t reader_count)
+{
+   const T_EDGE_DATA_LIST* list;
+   std::vector<std::thread> readers;
+   uint64_t received;
+   uint64_t start;
+   uint64_t duration_ns;
+   char name[64];
+
+   if ((!benchmark_server_start(READ_COUNT, 1)) || (edge_data_connect() != E_EDGE_DATA_RETVAL_OK))
+   {
+      return false;
+   }
+   list = edge_data_discover();
+   s_stop = false;
+   s_reads = 0;
+   s_torn = 0;
+   s_sent = edge_data_fd->stream_received;
+   std::thread sender(s_sender);
+   usleep(100000);
+
+   received = __atomic_load_n(&edge_data_fd->stream_received, __ATOMIC_RELAXED);
+   start = benchmark_now_ns();
+   for (uint32_t k = 0; k < reader_count; k++)
+   {  /* no two threads read the same handle, the external values are application memory */
+      uint32_t first = (uint32_t)(((uint64_t)list->read_handle_list_len * k) / reader_count);
+      uint32_t last = (uint32_t)(((uint64_t)list->read_handle_list_len * (k + 1)) / reader_count);
+      readers.push_back(std::thread(s_reader, &list->read_handle_list[first], last - first));
+   }
+   usleep(DURATION_US);
+   received = __atomic_load_n(&edge_data_fd->stream_received, __ATOMIC_RELAXED) - received;
+   duration_ns = benchmark_now_ns() - start;
+   s_stop = true;
+   for (uint32_t k = 0; k < readers.size(); k++)
+   {
+      readers[k].join();
+   }
+   sender.join();
+
+   snprintf(name, sizeof(name), "%u readers: event received", reader_count);
+   benchmark_print(name, duration_ns, (uint32_t)received);
+   snprintf(name, sizeof(name), "%u readers: sync_read", reader_count);
+   benchmark_print(name, duration_ns, (uint32_t)s_reads);
+   printf("%u readers: %lu torn values\n", reader_count, (unsigned long)s_torn);
+   edge_data_disconnect();
+   benchmark_server_stop();
+   return true;
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     receive thread and edge_data_sync_read() readers of 10000 values at the same time
+*****************************************************************************/
+int main()
+{
+   const uint32_t reader_counts[] = { 1, 4, 8 };
+
+   edge_data_register_logger(benchmark_logger);
+   for (uint32_t i = 0; i < sizeof(reader_counts) / sizeof(reader_counts[0]); i++)
+   {
+      if (!s_measure(reader_counts[i]))
+      {
+         printf("%u readers failed\n", reader_counts[i]);
+         return 1;
+      }
+   }
+   return 0;
+}
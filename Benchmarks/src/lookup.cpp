@@ -0,0 +1,150 @@
+/* 
+ * siapp-sdk
+ *
+ * SPDX-License-Identifier: MIT
+ * Copyright 2020 Siemens AG
+ *
+ */
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+#include <benchmark.h>
+
+#define ROUNDS          5
+#define CALLS           500
+#define READ_COUNT      10000
+#define WRITE_COUNT     1
+
+/* previous lookup of the values of a connection: std::map by handle, searched under the data lock */
+static std::map<uint32_t, EDGEDATA_VALUES> s_map_values;
+static pthread_mutex_t s_map_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*!
+******************************************************************************
+DESCRIPTION:     edge_data_sync_read() with the previous std::map lookup
+*****************************************************************************/
+static E_EDGE_DATA_RETVAL s_map_sync_read(T_EDGE_DATA_HANDLE* read_handle_list, uint32_t read_handle_list_len)
+{
+   E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
+   pthread_mutex_lock(&s_map_mutex);
+   for (uint32_t i = 0; i < read_handle_list_len; i++)
+   {
+      std::map<uint32_t, EDGEDATA_VALUES>::iterator it = s_map_values.find(read_handle_list[i]);
+      if (it == s_map_values.end())
+      {
+         ret = E_EDGE_DATA_RETVAL_NOK;
+         break;
+      }
+      (void)memcpy(it->second.external, it->second.internal, sizeof(T_EDGE_DATA));
+   }
+   pthread_mutex_unlock(&s_map_mutex);
+   return ret;
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     edge_data_get_data() with the previous std::map lookup
+*****************************************************************************/
+static T_EDGE_DATA* s_map_get_data(T_EDGE_DATA_HANDLE handle)
+{
+   T_EDGE_DATA* ret = NULL;
+   pthread_mutex_lock(&s_map_mutex);
+   std::map<uint32_t, EDGEDATA_VALUES>::iterator it = s_map_values.find(handle);
+   if (it != s_map_values.end())
+   {
+      ret = it->second.external;
+   }
+   pthread_mutex_unlock(&s_map_mutex);
+   return ret;
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     best of ROUNDS runs of CALLS reads of the handle list, time per handle
+*****************************************************************************/
+static void s_measure_sync_read(const char* name, E_EDGE_DATA_RETVAL (*sync_read)(T_EDGE_DATA_HANDLE*, uint32_t), std::vector<T_EDGE_DATA_HANDLE>& handles)
+{
+   uint64_t best_ns = UINT64_MAX;
+   for (uint32_t r = 0; r < ROUNDS; r++)
+   {
+      uint64_t start = benchmark_now_ns();
+      for (uint32_t i = 0; i < CALLS; i++)
+      {
+         if (sync_read(&handles[0], (uint32_t)handles.size()) != E_EDGE_DATA_RETVAL_OK)
+         {
+            printf("%s failed\n", name);
+            return;
+         }
+      }
+      best_ns = std::min(best_ns, benchmark_now_ns() - start);
+   }
+   benchmark_print(name, best_ns / CALLS, (uint32_t)handles.size());
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     best of ROUNDS runs of CALLS lookups of every handle, time per handle
+*****************************************************************************/
+static void s_measure_get_data(const char* name, T_EDGE_DATA* (*get_data)(T_EDGE_DATA_HANDLE), std::vector<T_EDGE_DATA_HANDLE>& handles)
+{
+   uint64_t best_ns = UINT64_MAX;
+   for (uint32_t r = 0; r < ROUNDS; r++)
+   {
+      uint64_t start = benchmark_now_ns();
+      for (uint32_t i = 0; i < CALLS; i++)
+      {
+         for (uint32_t k = 0; k < handles.size(); k++)
+         {
+            if (get_data(handles[k]) == NULL)
+            {
+               printf("%s failed\n", name);
+               return;
+            }
+         }
+      }
+      best_ns = std::min(best_ns, benchmark_now_ns() - start);
+   }
+   benchmark_print(name, best_ns / CALLS, (uint32_t)handles.size());
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     value lookup by handle over 10000 read handles, flat table of the connection vs. std::map
+*****************************************************************************/
+int main()
+{
+   const T_EDGE_DATA_LIST* list;
+   std::vector<T_EDGE_DATA_HANDLE> ordered;
+   std::vector<T_EDGE_DATA_HANDLE> shuffled;
+   std::mt19937 random(1);
+
+   edge_data_register_logger(benchmark_logger);
+   if ((!benchmark_server_start(READ_COUNT, WRITE_COUNT)) || (edge_data_connect() != E_EDGE_DATA_RETVAL_OK))
+   {
+      printf("connect failed\n");
+      return 1;
+   }
+   list = edge_data_discover();
+   ordered.assign(list->read_handle_list, list->read_handle_list + list->read_handle_list_len);
+   shuffled = ordered;
+   std::shuffle(shuffled.begin(), shuffled.end(), random);
+   /* the same values, found through a std::map as before the flat table */
+   for (uint32_t i = 0; i < edge_data_fd->read_values.entries.size(); i++)
+   {
+      EDGEDATA_VALUES* values = &edge_data_fd->read_values.entries[i];
+      s_map_values[values->internal->handle] = *values;
+   }
+
+   s_measure_sync_read("std::map sync_read, list order", s_map_sync_read, ordered);
+   s_measure_sync_read("flat table sync_read, list order", edge_data_sync_read, ordered);
+   s_measure_sync_read("std::map sync_read, shuffled", s_map_sync_read, shuffled);
+   s_measure_sync_read("flat table sync_read, shuffled", edge_data_sync_read, shuffled);
+   s_measure_get_data("std::map get_data, shuffled", s_map_get_data, shuffled);
+   s_measure_get_data("flat table get_data, shuffled", edge_data_get_data, shuffled);
+   edge_data_disconnect();
+   benchmark_server_stop();
+   return 0;
+}
@@ -0,0 +1,82 @@
+/* 
+ * siapp-sdk
+ *
+ * SPDX-License-Identifier: MIT
+ * Copyright 2020 Siemens AG
+ *
+ */
+
+#include <benchmark.h>
+
+#define ROUNDS          10
+#define READ_COUNT      100
+#define WRITE_COUNT     50
+
+/*!
+******************************************************************************
+DESCRIPTION:     connect and read all values once
+*****************************************************************************/
+static bool s_connect(void)
+{
+   const T_EDGE_DATA_LIST* list;
+   if (edge_data_connect() != E_EDGE_DATA_RETVAL_OK)
+   {
+      return false;
+   }
+   list = edge_data_discover();
+   return (list != NULL) && (edge_data_sync_read(list->read_handle_list, list->read_handle_list_len) == E_EDGE_DATA_RETVAL_OK);
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     disconnect to reconnect time, initiated by the application and by a lost backend
+*****************************************************************************/
+int main()
+{
+   uint64_t app_ns = 0;
+   uint64_t detect_ns = 0;
+   uint64_t backend_ns = 0;
+   uint64_t start;
+   T_EDGE_DATA_HANDLE handle = BENCHMARK_READ_HANDLE(0);
+
+   edge_data_register_logger(benchmark_logger);
+   if ((!benchmark_server_start(READ_COUNT, WRITE_COUNT)) || (!s_connect()))
+   {
+      printf("connect failed\n");
+      return 1;
+   }
+   for (uint32_t i = 0; i < ROUNDS; i++)
+   {
+      /* application: edge_data_disconnect() followed by edge_data_connect() */
+      start = benchmark_now_ns();
+      edge_data_disconnect();
+      if (!s_connect())
+      {
+         printf("reconnect failed\n");
+         return 1;
+      }
+      app_ns += benchmark_now_ns() - start;
+
+      /* backend: the server side is closed, the application notices it and connects to a new one */
+      start = benchmark_now_ns();
+      benchmark_server_stop();
+      while (edge_data_sync_read(&handle, 1) != E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY)
+      {
+         usleep(10);
+      }
+      detect_ns += benchmark_now_ns() - start;
+      start = benchmark_now_ns();
+      if ((!benchmark_server_start(READ_COUNT, WRITE_COUNT)) || (!s_connect()))
+      {
+         printf("connect to new backend failed\n");
+         return 1;
+      }
+      backend_ns += benchmark_now_ns() - start;
+   }
+   benchmark_print("disconnect + connect", app_ns, ROUNDS);
+   benchmark_print("backend closed until detected", detect_ns, ROUNDS);
+   benchmark_print("detected until connected", backend_ns, ROUNDS);
+   edge_data_disconnect();
+   benchmark_server_stop();
+   return 0;
+}
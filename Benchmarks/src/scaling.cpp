@@ -0,0 +1,130 @@
+/* 
+ * siapp-sdk
+ *
+ * SPDX-License-Identifier: MIT
+ * Copyright 2020 Siemens AG
+ *
+ */
+
+#include <vector>
+#include <algorithm>
+#include <random>
+
+#include <benchmark.h>
+
+#define WRITE_COUNT     100
+#define VISITS          10000000  /* handles visited per measurement, calls = VISITS / data points */
+
+/*!
+******************************************************************************
+DESCRIPTION:     edge_data_sync_read() calls over the whole list, time per handle
+*****************************************************************************/
+static void s_measure_sync_read(const char* name, T_EDGE_DATA_HANDLE* handles, uint32_t handles_len)
+{
+   uint32_t calls = std::max(1u, VISITS / handles_len);
+   uint64_t start = benchmark_now_ns();
+   for (uint32_t i = 0; i < calls; i++)
+   {
+      if (edge_data_sync_read(handles, handles_len) != E_EDGE_DATA_RETVAL_OK)
+      {
+         printf("%s failed\n", name);
+         return;
+      }
+   }
+   benchmark_print(name, (benchmark_now_ns() - start) / calls, handles_len);
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     connect, discover and lookups with read_count read values
+*****************************************************************************/
+static bool s_measure(uint32_t read_count)
+{
+   const T_EDGE_DATA_LIST* list;
+   std::vector<T_EDGE_DATA_HANDLE> shuffled;
+   std::mt19937 random(1);
+   uint64_t start;
+   uint32_t calls;
+   char name[64];
+   char topic[32];
+
+   if (!benchmark_server_start(read_count, WRITE_COUNT))
+   {
+      return false;
+   }
+   start = benchmark_now_ns();
+   if (edge_data_connect() != E_EDGE_DATA_RETVAL_OK)
+   {
+      benchmark_server_stop();
+      return false;
+   }
+   list = edge_data_discover();
+   snprintf(name, sizeof(name), "%u: connect incl. discover", read_count);
+   benchmark_print(name, benchmark_now_ns() - start, 1);
+   if ((list == NULL) || (list->read_handle_list_len != read_count) || (list->write_handle_list_len != WRITE_COUNT))
+   {
+      printf("discover incomplete\n");
+      return false;
+   }
+
+   snprintf(name, sizeof(name), "%u: sync_read, list order", read_count);
+   s_measure_sync_read(name, list->read_handle_list, list->read_handle_list_len);
+   shuffled.assign(list->read_handle_list, list->read_handle_list + list->read_handle_list_len);
+   std::shuffle(shuffled.begin(), shuffled.end(), random);
+   snprintf(name, sizeof(name), "%u: sync_read, shuffled", read_count);
+   s_measure_sync_read(name, &shuffled[0], (uint32_t)shuffled.size());
+
+   calls = std::max(1u, VISITS / read_count);
+   start = benchmark_now_ns();
+   for (uint32_t i = 0; i < calls; i++)
+   {
+      for (uint32_t k = 0; k < shuffled.size(); k++)
+      {
+         if (edge_data_get_data(shuffled[k]) == NULL)
+         {
+            printf("get_data failed\n");
+            return false;
+         }
+      }
+   }
+   snprintf(name, sizeof(name), "%u: get_data, shuffled", read_count);
+   benchmark_print(name, (benchmark_now_ns() - start) / calls, read_count);
+
+   /* topics of the loopback server, see benchmark_server_start */
+   start = benchmark_now_ns();
+   for (uint32_t i = 0; i < read_count; i++)
+   {
+      snprintf(topic, sizeof(topic), "read%u", (uint32_t)(((uint64_t)i * 7919) % read_count));
+      if (edge_data_get_readable_handle(topic) == 0)
+      {
+         printf("get_readable_handle failed\n");
+         return false;
+      }
+   }
+   snprintf(name, sizeof(name), "%u: get_readable_handle", read_count);
+   benchmark_print(name, benchmark_now_ns() - start, read_count);
+
+   edge_data_disconnect();
+   benchmark_server_stop();
+   return true;
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     discover and lookup cost at 10k, 100k and 1M data points
+*****************************************************************************/
+int main()
+{
+   const uint32_t read_counts[] = { 10000, 100000, 1000000 };
+
+   edge_data_register_logger(benchmark_logger);
+   for (uint32_t i = 0; i < sizeof(read_counts) / sizeof(read_counts[0]); i++)
+   {
+      if (!s_measure(read_counts[i]))
+      {
+         printf("%u data points failed\n", read_counts[i]);
+         return 1;
+      }
+   }
+   return 0;
+}
@@ -0,0 +1,105 @@
+/* 
+ * siapp-sdk
+ *
+ * SPDX-License-Identifier: MIT
+ * Copyright 2020 Siemens AG
+ *
+ */
+
+#include <benchmark.h>
+
+#define WRITE_COUNT     20000
+#define EVENT_COUNT     100000
+
+static std::atomic<uint32_t> s_events(0);
+
+/*!
+******************************************************************************
+DESCRIPTION:     subscribe callback, counts the received events
+*****************************************************************************/
+static void s_event_cb(T_EDGE_DATA* event)
+{
+   s_events++;
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     server side: send EVENT_COUNT events to a client
+*****************************************************************************/
+static void s_send_events(void* fd, void* context)
+{
+   T_EDGE_DATA_VALUE value;
+   for (uint32_t i = 1; i <= EVENT_COUNT; i++)
+   {
+      value.uint32 = i;
+      if (!edgedata_flatbuffers_edge_event_send(fd, BENCHMARK_READ_HANDLE(0), E_EDGE_DATA_TYPE_UINT32, 0, &value, i))
+      {
+         printf("event send failed\n");
+         return;
+      }
+   }
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     sync_write round trip and event throughput of one transport
+*****************************************************************************/
+static bool s_run(const char* transport, uint32_t shared_memory)
+{
+   char name[64];
+   const T_EDGE_DATA_LIST* list;
+   T_EDGE_DATA_HANDLE handle;
+   T_EDGE_DATA* data;
+   uint64_t start;
+
+   edge_data_set_option(E_EDGE_DATA_OPTION_SHARED_MEMORY, shared_memory);
+   if ((!benchmark_server_start(1, 1)) || (edge_data_connect() != E_EDGE_DATA_RETVAL_OK))
+   {
+      printf("%s: connect failed\n", transport);
+      return false;
+   }
+   list = edge_data_discover();
+   handle = list->write_handle_list[0];
+   data = edge_data_get_data(handle);
+
+   start = benchmark_now_ns();
+   for (uint32_t i = 0; i < WRITE_COUNT; i++)
+   {
+      data->value.uint32 = i;
+      if (edge_data_sync_write(&handle, 1) != E_EDGE_DATA_RETVAL_OK)
+      {
+         printf("%s: sync write failed\n", transport);
+         break;
+      }
+   }
+   snprintf(name, sizeof(name), "%s sync_write round trip", transport);
+   benchmark_print(name, benchmark_now_ns() - start, WRITE_COUNT);
+
+   s_events = 0;
+   edge_data_subscribe_event(list->read_handle_list[0], s_event_cb);
+   start = benchmark_now_ns();
+   edgedata_ipc_server_broadcast(edgedata_ipc_loopback_server, s_send_events, NULL);
+   while (s_events < EVENT_COUNT)
+   {
+      usleep(100);
+   }
+   snprintf(name, sizeof(name), "%s event", transport);
+   benchmark_print(name, benchmark_now_ns() - start, EVENT_COUNT);
+
+   edge_data_disconnect();
+   benchmark_server_stop();
+   return true;
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     compare the socket and the shared memory transport over the in-process loopback server
+*****************************************************************************/
+int main()
+{
+   bool ok;
+   edge_data_register_logger(benchmark_logger);
+   ok = s_run("socket", 0);
+   ok = s_run("shared memory", 1) && ok;
+   return ok ? 0 : 1;
+}
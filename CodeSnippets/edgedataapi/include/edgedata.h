@@ -31,6 +31,8 @@ typedef enum {
    E_EDGE_DATA_RETVAL_INVALID_VALUE = -3,
    E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY = -4,
    E_EDGE_DATA_RETVAL_UNKNOWN_HANDLE = -5,
+   E_EDGE_DATA_RETVAL_TIMEOUT = -6,
+   E_EDGE_DATA_RETVAL_WOULD_BLOCK = -7,
 } E_EDGE_DATA_RETVAL;
 
 /* Data Type */
@@ -75,12 +77,52 @@ typedef struct {
    uint32_t    write_handle_list_len;
 }  T_EDGE_DATA_LIST;
 
+/* Runtime Options (see edge_data_set_option) */
+typedef enum {
+   E_EDGE_DATA_OPTION_SHARED_MEMORY = 0,   /* 0: unix socket only, 1: negotiate shared memory rings (fallback to unix socket) */
+   E_EDGE_DATA_OPTION_SEQPACKET = 1,       /* 0: SOCK_STREAM, 1: SOCK_SEQPACKET (client falls back to SOCK_STREAM) */
+   E_EDGE_DATA_OPTION_IO_URING = 2,        /* 0: read(), 1: receive with io_uring multishot recv (fallback to read()) */
+   E_EDGE_DATA_OPTION_BUSY_POLL_US = 3,    /* 0: blocking receive, >0: spin with non-blocking reads for this many microseconds before blocking */
+   E_EDGE_DATA_OPTION_RECV_THREAD_CPU = 4, /* -1: no pinning, >=0: pin the receive thread to this CPU */
+   E_EDGE_DATA_OPTION_PROCESS_BY_CALLER = 5, /* 0: receive thread, 1: no internal threads, the application calls edge_data_process() */
+} E_EDGE_DATA_OPTION;
+
+/* Statistics of the current connection (see edge_data_get_statistics) */
+typedef struct {
+   uint64_t                      messages_sent;       /* RPC messages sent */
+   uint64_t                      messages_received;   /* RPC messages received */
+   uint64_t                      bytes_sent;          /* header and payload bytes sent */
+   uint64_t                      bytes_received;      /* header and payload bytes received */
+   uint64_t                      bytes_copied_send;   /* payload bytes copied in user space before sending */
+   uint64_t                      bytes_copied_recv;   /* bytes copied in user space after receiving */
+   uint64_t                      recv_calls;          /* read calls on the transport */
+   uint64_t                      recv_spin_hits;      /* busy poll: reads that found data while spinning */
+   uint64_t                      recv_blocking_waits; /* busy poll: spin budget exhausted, blocking read */
+   uint64_t                      request_timeouts;    /* requests without reply before their deadline */
+   uint64_t                      credit_stalls;       /* writes delayed or refused because the backend had no credit left */
+   uint64_t                      send_queue_control;  /* threads waiting to send ping, discover, replies (current) */
+   uint64_t                      send_queue_bulk;     /* threads waiting to send data updates (current), sent after control */
+   uint64_t                      send_queue_control_max; /* maximum of send_queue_control */
+   uint64_t                      send_queue_bulk_max; /* maximum of send_queue_bulk */
+   uint64_t                      callback_calls;      /* received messages handed to their handler on the receive thread */
+   uint64_t                      callback_time_ns;    /* time spent in the handlers, subscribe and write completion callbacks included */
+   uint64_t                      event_callback_calls; /* part of callback_calls: events */
+   uint64_t                      event_callback_time_ns; /* part of callback_time_ns: events */
+} T_EDGE_DATA_STATISTICS;
+
 /* EVENT CALLBACK FUNCTION */
 typedef void (*cb_edge_data_subscribe) (T_EDGE_DATA* event);
 
 /* LOGGER CALLBACK FUNCTION */
 typedef void (*cb_edge_data_logger) (const char* text);
 
+/* ASYNCHRONOUS WRITE COMPLETION (called by the receive thread, must not block or call edge_data_sync_write) */
+typedef uint32_t T_EDGE_DATA_TOKEN;
+typedef void (*cb_edge_data_write_complete) (T_EDGE_DATA_TOKEN token, E_EDGE_DATA_RETVAL result, void* context);
+
+/* CREDIT CALLBACK (called by the receive thread once the backend accepts writes again after E_EDGE_DATA_RETVAL_WOULD_BLOCK) */
+typedef void (*cb_edge_data_credit) (void* context);
+
 /**********/
 #ifdef __cplusplus
 extern "C" {
@@ -91,7 +133,7 @@ extern "C" {
 
    extern E_EDGE_DATA_RETVAL edge_data_disconnect();
 
-   /* DISCOVER INIT */
+   /* DISCOVER INIT (again after every edge_data_connect, the handles belong to the current connection) */
    extern const T_EDGE_DATA_LIST* edge_data_discover();
 
    /* GET HANDLE FOR A READABLE TOPIC */
@@ -110,9 +152,18 @@ extern "C" {
    /* READ MULTIPLE DATA LIST ENTRIES */
    extern E_EDGE_DATA_RETVAL edge_data_sync_read(T_EDGE_DATA_HANDLE* read_handle_list, uint32_t read_handle_list_len);
 
+   /* READ ONLY CHANGED DATA LIST ENTRIES (changed_handle_list holds up to read_handle_list_len handles) */
+   extern E_EDGE_DATA_RETVAL edge_data_sync_read_changed(T_EDGE_DATA_HANDLE* read_handle_list, uint32_t read_handle_list_len, T_EDGE_DATA_HANDLE* changed_handle_list, uint32_t* changed_handle_list_len);
+
    /* WRITE MULTIPLE DATA LIST ENTRIES (Sync update or trigger an event is managed by the backend) */
    extern E_EDGE_DATA_RETVAL edge_data_sync_write(T_EDGE_DATA_HANDLE* write_handle_list, uint32_t write_handle_list_len);
 
+   /* WRITE MULTIPLE DATA LIST ENTRIES, WAIT AT MOST timeout_ms FOR THE BACKEND */
+   extern E_EDGE_DATA_RETVAL edge_data_sync_write_timeout(T_EDGE_DATA_HANDLE* write_handle_list, uint32_t write_handle_list_len, uint32_t timeout_ms);
+
+   /* WRITE MULTIPLE DATA LIST ENTRIES WITHOUT WAITING (cb is called once all values are confirmed, only if E_EDGE_DATA_RETVAL_OK is returned) */
+   extern E_EDGE_DATA_RETVAL edge_data_sync_write_async(T_EDGE_DATA_HANDLE* write_handle_list, uint32_t write_handle_list_len, cb_edge_data_write_complete cb, void* context, T_EDGE_DATA_TOKEN* token);
+
    /**********************/
    /* REGISTER CALLBACKS */
    /**********************/
@@ -123,6 +174,32 @@ extern "C" {
    /* REGISTER LOGGER CALLBACK */
    extern E_EDGE_DATA_RETVAL edge_data_register_logger(cb_edge_data_logger cb);
 
+   /* REGISTER CREDIT CALLBACK */
+   extern E_EDGE_DATA_RETVAL edge_data_register_credit_callback(cb_edge_data_credit cb, void* context);
+
+   /***********/
+   /* OPTIONS */
+   /***********/
+
+   /* SET RUNTIME OPTION (takes effect with the next edge_data_connect, E_EDGE_DATA_OPTION_BUSY_POLL_US immediately) */
+   extern E_EDGE_DATA_RETVAL edge_data_set_option(E_EDGE_DATA_OPTION option, int64_t value);
+
+   /* GET STATISTICS OF THE CURRENT CONNECTION */
+   extern E_EDGE_DATA_RETVAL edge_data_get_statistics(T_EDGE_DATA_STATISTICS* statistics);
+
+   /* GET EVENT FILE DESCRIPTOR FOR POLL/EPOLL (readable when values changed, read the 8 byte counter to reset it) */
+   extern int32_t edge_data_get_event_fd();
+
+   /*************************************************/
+   /* PROCESS BY CALLER (E_EDGE_DATA_OPTION_PROCESS_BY_CALLER) */
+   /*************************************************/
+
+   /* GET FILE DESCRIPTOR FOR POLL/EPOLL (readable when edge_data_process has work, -1 with receive thread) */
+   extern int32_t edge_data_get_fd();
+
+   /* RECEIVE, DISPATCH AND KEEP ALIVE ON THE CALLING THREAD, WAIT AT MOST timeout_ms (-1: until something happened) */
+   extern E_EDGE_DATA_RETVAL edge_data_process(int32_t timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
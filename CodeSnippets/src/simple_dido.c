@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <unistd.h>
+#include <poll.h>
 
 #include <edgedata.h>
 #include "helper.h"
@@ -47,7 +48,7 @@ static void s_edgedata_logger(const char* info)
     Processing steps are:
       - connect to edge data interface
       - check, if signals DI_NAME and DO_NAME exists
-      - on regular basis read 'test_signal_di' -> write state to 'tests_signal_do'  
+      - on every change of 'test_signal_di' -> write state to 'tests_signal_do'  
 */
 int main(int argc, char** argv)
 {
@@ -136,6 +137,11 @@ int main(int argc, char** argv)
       T_EDGE_DATA_VALUE        act_value;
       memset(&act_value,0,sizeof(act_value));
 
+      /* signaled by the edge data interface when values changed */
+      struct pollfd event_pfd;
+      event_pfd.fd = edge_data_get_event_fd();
+      event_pfd.events = POLLIN;
+
       /* read di data in loop and update do*/
       while (s_keepRunning)
       {
@@ -175,8 +181,12 @@ int main(int argc, char** argv)
                break;
             }
          }
-         /* 10ms wait */
-         usleep(10000);
+         /* wait for the next change (at most 1s) */
+         if (poll(&event_pfd, 1, 1000) > 0)
+         {
+            uint64_t counter;
+            (void)read(event_pfd.fd, &counter, sizeof(counter));
+         }
       }
    }
 
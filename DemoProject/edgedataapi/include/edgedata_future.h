@@ -0,0 +1,33 @@
+/* 
+ * siapp-sdk
+ *
+ * SPDX-License-Identifier: MIT
+ * Copyright 2020 Siemens AG
+ *
+ */
+
+#pragma once
+#include <future>
+#include <edgedata.h>
+
+/* C++: edge_data_sync_write_async as std::future (ready when all values are confirmed) */
+inline void edge_data_sync_write_future_cb(T_EDGE_DATA_TOKEN token, E_EDGE_DATA_RETVAL result, void* context)
+{
+   std::promise<E_EDGE_DATA_RETVAL>* promise = (std::promise<E_EDGE_DATA_RETVAL>*)context;
+   (void)token;
+   promise->set_value(result);
+   delete promise;
+}
+
+inline std::future<E_EDGE_DATA_RETVAL> edge_data_sync_write_future(T_EDGE_DATA_HANDLE* write_handle_list, uint32_t write_handle_list_len)
+{
+   std::promise<E_EDGE_DATA_RETVAL>* promise = new std::promise<E_EDGE_DATA_RETVAL>();
+   std::future<E_EDGE_DATA_RETVAL> future = promise->get_future();
+   E_EDGE_DATA_RETVAL ret = edge_data_sync_write_async(write_handle_list, write_handle_list_len, edge_data_sync_write_future_cb, promise, NULL);
+   if (ret != E_EDGE_DATA_RETVAL_OK)
+   {  /* no callback follows */
+      promise->set_value(ret);
+      delete promise;
+   }
+   return future;
+}
@@ -30,6 +30,7 @@ using namespace edgedata_flatbuffers::EdgeDataInfo_;
 /*      Register Callback for different Message Types */
 /* THREAD Layer                                       */
 /*      Receiving Thread, Keep Alive Thread           */
+/*      Multi Client Server Loop (epoll)              */
 /* ************************************************** */
 /* FLATBUFFER Layer                                   */
 /*      Flatbuffer                                    */
@@ -73,30 +74,134 @@ void edgedata_logger(const char* pre_text, const char* file, unsigned int line,
 
 /* ********** GENERAL ***************** */
 
+/* configuration used for new connections (see edge_data_set_option) */
+EDGEDATA_IPC_CONFIG edgedata_ipc_config = { false, false, false, 0, -1, false };
+/* if set, edge_data_connect connects in-process to this server instead of the unix socket */
+EDGEDATA_IPC_SERVER* edgedata_ipc_loopback_server = NULL;
+
+static void edgedata_ipc_shm_free(EDGEDATA_SHM_TRANSPORT** shm);
+static void edgedata_ipc_uring_free(EDGEDATA_URING** uring);
+static void edgedata_rpc_stream_acked(void* fd, unsigned char* payload, uint32_t payload_len);
+void edgedata_rpc_unlock_pending_requests(EDGEDATA_IPC_FD* fd);
+uint32_t edgedata_rpc_dummy_with_reply_ack(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len);
+
+static int64_t edgedata_time_ms()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((int64_t)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+static int64_t edgedata_time_us()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((int64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static int64_t edgedata_time_ns()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((int64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static inline void edgedata_cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+   __asm__ __volatile__("yield");
+#endif
+}
+
 static EDGEDATA_IPC_FD* ipc_new_fd(bool b_stream_channel)
 {
    EDGEDATA_IPC_FD* fd = new EDGEDATA_IPC_FD();
    if (fd != NULL)
    {
+      fd->config = edgedata_ipc_config;
+      fd->b_nonblocking = false;
+      fd->b_would_block = false;
+      fd->b_spinning = false;
+      fd->shm = NULL;
+      fd->shm_pending = NULL;
+      fd->received_fds_len = 0;
+      fd->uring = NULL;
+      fd->p_recv_message = &fd->recv_message;
+      fd->recv_buffer_start = 0;
+      fd->recv_buffer_end = 0;
       fd->sequence = 0;
-      fd->b_wait_for_reply = false;
-      fd->b_wait_for_reply_error = false;
-      fd->wait_for_reply_sequence = 0;
-      fd->wait_for_reply_mutex = PTHREAD_MUTEX_INITIALIZER;
-      fd->single_concurrent_request_mutex = PTHREAD_MUTEX_INITIALIZER;
+      fd->peer_capabilities = 0;
+      fd->reassembly_type = 0;
+      fd->reassembly_sequence = 0;
+      fd->b_reassembled = false;
+      fd->p_large_reply = NULL;
+      fd->b_pending_requests_closed = false;
+      fd->peer_credits = 0;
+      fd->b_credit_wanted = false;
+      fd->credit_cb = NULL;
+      fd->recv_credits = RPC_CREDITS;
+      fd->b_recv_batch_start = true;
+      fd->stream_sent = 0;
+      fd->stream_acked = 0;
+      fd->stream_received = 0;
+      fd->stream_ack_sent = 0;
+      fd->stream_unacked_ms = 0;
+      pthread_condattr_t attr;
+      pthread_condattr_init(&attr);
+      pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+      pthread_cond_init(&fd->window_cond, &attr);
+      pthread_condattr_destroy(&attr);
+      fd->pending_requests_mutex = PTHREAD_MUTEX_INITIALIZER;
       fd->critical_section_mutex = PTHREAD_MUTEX_INITIALIZER;
+      fd->lane_waiting[RPC_LANE_CONTROL] = 0;
+      fd->lane_waiting[RPC_LANE_BULK] = 0;
+      fd->b_lane_sending = false;
+      fd->send_lanes_mutex = PTHREAD_MUTEX_INITIALIZER;
+      pthread_cond_init(&fd->send_lanes_cond, NULL);
+      fd->b_recv_thread = false;
+      fd->b_recv_by_caller = false;
+      fd->b_recv_busy = false;
+      fd->b_defer_callbacks = false;
+      fd->b_credit_cb_deferred = false;
+      fd->recv_epoll_fd = -1;
+      fd->recv_wait_fd = -1;
+      fd->shutdown_event_fd = -1;
       fd->b_shutdown = false;
+      fd->keep_alive_timer_fd = -1;
+      fd->stream_ack_timer_fd = -1;
+      fd->b_stream_ack_armed = false;
+      fd->last_recv_ms = 0;
+      fd->last_ping_ms = 0;
+      fd->last_send_sequence = 0;
+      fd->last_send_ms = 0;
+      fd->ref_count = 0;
+      fd->b_shm_polled = false;
+      fd->b_epollout = false;
+      fd->b_send_queue = false;
+      fd->send_queue_start = 0;
+      fd->send_progress_ms = 0;
+      fd->b_send_failed = false;
+      fd->b_send_queued = false;
+      fd->server_wake_fd = -1;
+      fd->b_discovered = false;
       fd->b_channel_type_stream = b_stream_channel;
       fd->b_connected = true;
-      fd->it_read_discover_info = fd->read_values.begin();
-      fd->it_write_discover_info = fd->write_values.begin();
-
-      pthread_mutex_lock(&fd->wait_for_reply_mutex);
+      fd->read_discover_pos = 0;
+      fd->write_discover_pos = 0;
+      fd->discover_arena.p_front = NULL;
+      fd->discover_arena.p_back = NULL;
+      (void)memset(fd->dispatch, 0, sizeof(fd->dispatch));
+      /* handled by every connection */
+      (void)edgedata_callback_register(fd, MSG_TYPE_PING, edgedata_rpc_dummy_ack);
+      (void)edgedata_callback_with_reply_register(fd, MSG_TYPE_PING, edgedata_rpc_dummy_with_reply_ack);
+      (void)edgedata_callback_register(fd, MSG_TYPE_EVENT_ACK, edgedata_rpc_stream_acked);
    }
    return fd;
 }
 
-/* called only by recv thread */
+/* called only by the receive loop (or by disconnect if there is none) */
 static void edgedata_ipc_close(EDGEDATA_IPC_FD* fd)
 {
    ENTER_CRITICAL_SECTION(fd);
@@ -114,6 +219,17 @@ static void edgedata_ipc_close(EDGEDATA_IPC_FD* fd)
          close(fd->read_fd);
          fd->read_fd = 0;
       }
+      edgedata_ipc_shm_free(&fd->shm);
+      edgedata_ipc_shm_free(&fd->shm_pending);
+      edgedata_ipc_uring_free(&fd->uring);
+      for (uint32_t i = 0; i < fd->received_fds_len; i++)
+      {
+         close(fd->received_fds[i]);
+      }
+      fd->received_fds_len = 0;
+      fd->send_queue.clear();
+      fd->send_queue_start = 0;
+      fd->server_wake_fd = -1;
    }
    LEAVE_CRITICAL_SECTION(fd);
 }
@@ -137,12 +253,85 @@ void edgedata_ipc_disconnect(EDGEDATA_IPC_FD** fd)
    /* only the receive task can close the channel */
    DEBUG_LOCK_LOG("Trigger THREADS to SHUTDOWN\n");
    (*fd)->b_shutdown = true;
-   pthread_join((*fd)->p_thread_recv, NULL);
-   pthread_join((*fd)->p_thread_keep_alive, NULL);
+   /* wake the threads instead of waiting for the socket timeout: a blocking read returns 0 */
+   EDGEDATA_IPC_FD* m_fd = *fd;
+   ENTER_CRITICAL_SECTION(m_fd);
+   if ((m_fd->b_connected) && (m_fd->read_fd != 0))
+   {
+      shutdown(m_fd->read_fd, SHUT_RDWR);
+   }
+   LEAVE_CRITICAL_SECTION(m_fd);
+   if ((*fd)->shutdown_event_fd >= 0)
+   {
+      uint64_t counter = 1;
+      (void)write((*fd)->shutdown_event_fd, &counter, sizeof(counter));
+   }
+   if ((*fd)->b_recv_thread)
+   {
+      pthread_join((*fd)->p_thread_recv, NULL);
+   }
+   else if ((*fd)->b_connected)
+   {  /* no receive thread (edge_data_process) or it was never started */
+      edgedata_rpc_unlock_pending_requests(*fd);
+      edgedata_ipc_close(*fd);
+   }
+   if ((*fd)->recv_epoll_fd >= 0)
+   {
+      close((*fd)->recv_epoll_fd);
+      (*fd)->recv_epoll_fd = -1;
+   }
+   if ((*fd)->shutdown_event_fd >= 0)
+   {
+      close((*fd)->shutdown_event_fd);
+      (*fd)->shutdown_event_fd = -1;
+   }
+   if ((*fd)->keep_alive_timer_fd >= 0)
+   {
+      close((*fd)->keep_alive_timer_fd);
+      (*fd)->keep_alive_timer_fd = -1;
+   }
+   if ((*fd)->stream_ack_timer_fd >= 0)
+   {
+      close((*fd)->stream_ack_timer_fd);
+      (*fd)->stream_ack_timer_fd = -1;
+   }
    /* TODO calls wrong layer !!! */
    edgedata_data_cleanup(fd);
 }
 
+/* busy poll: non-blocking reads until data arrives or the spin budget is used up, then the normal read */
+static int32_t edgedata_ipc_read_transport(EDGEDATA_IPC_FD* fd, void* buff, uint32_t buff_len)
+{
+   /* may be changed by edge_data_set_option while the receive thread runs */
+   int64_t busy_poll_us = __atomic_load_n(&fd->config.busy_poll_us, __ATOMIC_RELAXED);
+   int64_t start_us;
+   int32_t retval;
+
+   if (busy_poll_us <= 0)
+   {
+      return fd->read((void*)fd, buff, buff_len);
+   }
+   start_us = edgedata_time_us();
+   fd->b_spinning = true;
+   do
+   {
+      retval = fd->read((void*)fd, buff, buff_len);
+      if ((retval >= 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+      {
+         fd->b_spinning = false;
+         if (retval > 0)
+         {
+            fd->statistics.recv_spin_hits++;
+         }
+         return retval;
+      }
+      edgedata_cpu_relax();
+   } while ((edgedata_time_us() - start_us) < busy_poll_us);
+   fd->b_spinning = false;
+   fd->statistics.recv_blocking_waits++;
+   return fd->read((void*)fd, buff, buff_len);
+}
+
 bool edgedata_ipc_read(EDGEDATA_IPC_FD* fd)
 {
    if (fd == NULL)
@@ -152,693 +341,3316 @@ bool edgedata_ipc_read(EDGEDATA_IPC_FD* fd)
    DEBUG_IPC_LOG("Try to read\n");
    if (fd->b_channel_type_stream)
    {
-      DEBUG_IPC_LOG("Try read Header\n");
-      /* read header */
-      int32_t retval = fd->read(fd->read_fd, (void*)&fd->recv_message, sizeof(fd->recv_message.header));
-      //if (read(fd->read_fd, (void*)&fd->recv_message, sizeof(fd->recv_message.header)) != sizeof(fd->recv_message.header))
-
-      if (retval != sizeof(fd->recv_message.header))
-      {
-         ERROR_LOG("edgedata_ipc_read Header Read Error (retval=%d)\n", retval);
-         return false;
-      }
-      DEBUG_IPC_LOG("Detected Payload Size: %d\n", fd->recv_message.header.msg_payload_len);
+      EDGEDATA_RPC_HEADER header;
+      uint32_t buffered;
+      uint32_t frame_len;
+      int32_t retval;
 
-      /* check max size of payload length */
-      if (fd->recv_message.header.msg_payload_len > sizeof(fd->recv_message.payload))
+      /* release previous frame */
+      if (fd->recv_buffer_start == fd->recv_buffer_end)
       {
-         ERROR_LOG("edgedata_ipc_read Max Payload Size Error\n");
-         return false;
+         fd->recv_buffer_start = 0;
+         fd->recv_buffer_end = 0;
       }
-      DEBUG_IPC_LOG("Try read Payload\n");
-      /* read payload (length depends on header) */
-      if (fd->read(fd->read_fd, (void*)&fd->recv_message.payload, fd->recv_message.header.msg_payload_len) != (int32_t)fd->recv_message.header.msg_payload_len)
+      while (true)
       {
-         ERROR_LOG("edgedata_ipc_read Payload Read Error\n");
-         return false;
+         buffered = fd->recv_buffer_end - fd->recv_buffer_start;
+         if (buffered >= sizeof(header))
+         {
+            memcpy(&header, &fd->recv_buffer[fd->recv_buffer_start], sizeof(header));
+            DEBUG_IPC_LOG("Detected Payload Size: %d\n", header.msg_payload_len);
+            /* check max size of payload length */
+            if (header.msg_payload_len > sizeof(fd->recv_message.payload))
+            {
+               ERROR_LOG("edgedata_ipc_read Max Payload Size Error\n");
+               return false;
+            }
+            frame_len = sizeof(header) + header.msg_payload_len;
+            if (buffered >= frame_len)
+            {  /* complete frame, use it in place if the payload is aligned */
+               if ((fd->recv_buffer_start % 8) == 0)
+               {
+                  fd->p_recv_message = (EDGEDATA_RPC_FULL_MSG*)&fd->recv_buffer[fd->recv_buffer_start];
+               }
+               else
+               {
+                  memcpy(&fd->recv_message, &fd->recv_buffer[fd->recv_buffer_start], frame_len);
+                  fd->p_recv_message = &fd->recv_message;
+                  fd->statistics.bytes_copied_recv += frame_len;
+               }
+               fd->recv_buffer_start += frame_len;
+               fd->statistics.messages_received++;
+               DEBUG_IPC_LOG("New Payload detected\n");
+               return true;
+            }
+         }
+         /* partial frame, make room for at least one full message */
+         if ((RECV_BUFFER_SIZE - fd->recv_buffer_end) < MSG_MAX_FULL_SIZE)
+         {
+            memmove(&fd->recv_buffer[0], &fd->recv_buffer[fd->recv_buffer_start], buffered);
+            fd->recv_buffer_start = 0;
+            fd->recv_buffer_end = buffered;
+         }
+         /* take everything that is available */
+         retval = edgedata_ipc_read_transport(fd, (void*)&fd->recv_buffer[fd->recv_buffer_end], RECV_BUFFER_SIZE - fd->recv_buffer_end);
+         fd->statistics.recv_calls++;
+         if ((retval < 0) && (errno == EINTR))
+         {
+            continue;
+         }
+         if ((retval < 0) && (fd->b_nonblocking) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+         {  /* no complete frame yet, the server loop continues on the next event */
+            fd->b_would_block = true;
+            return false;
+         }
+         if (retval <= 0)
+         {
+            if (!fd->b_shutdown)
+            {  /* on disconnect the socket is shut down on purpose */
+               ERROR_LOG("edgedata_ipc_read Read Error (retval=%d)\n", retval);
+            }
+            return false;
+         }
+         fd->recv_buffer_end += retval;
+         fd->statistics.bytes_received += retval;
       }
-      DEBUG_IPC_LOG("New Payload detected\n");
    }
    else
    {
-      /* NOT USED RIGHT NOW!! */
-      /*** IS SIZEOF TEST OK????? **/
+      /* SOCK_SEQPACKET: the kernel keeps message boundaries, one read returns one full message */
+      EDGEDATA_RPC_FULL_MSG* message = (EDGEDATA_RPC_FULL_MSG*)&fd->recv_buffer[0];
+      int32_t retval;
       DEBUG_IPC_LOG("Try read full Package\n");
-      /* read full message */
-      if (fd->read(fd->read_fd, (void*)&fd->recv_message, sizeof(fd->recv_message)) != sizeof(fd->recv_message))
+      do
       {
-         ERROR_LOG("edgedata_ipc_read Header Read Error\n");
+         retval = edgedata_ipc_read_transport(fd, (void*)&fd->recv_buffer[0], RECV_BUFFER_SIZE);
+         fd->statistics.recv_calls++;
+      } while ((retval < 0) && (errno == EINTR));
+
+      if ((retval < 0) && (fd->b_nonblocking) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+      {
+         fd->b_would_block = true;
+         return false;
+      }
+      if (retval < (int32_t)sizeof(message->header))
+      {
+         if (!fd->b_shutdown)
+         {
+            ERROR_LOG("edgedata_ipc_read Message Read Error (retval=%d)\n", retval);
+         }
          return false;
       }
       /* check max size of payload length */
-      if (fd->recv_message.header.msg_payload_len > sizeof(fd->recv_message.payload))
+      if (message->header.msg_payload_len > sizeof(message->payload))
       {
          ERROR_LOG("edgedata_rpc_ipc_read Max Payload Size Error\n");
          return false;
       }
+      if ((uint32_t)retval != (sizeof(message->header) + message->header.msg_payload_len))
+      {
+         ERROR_LOG("edgedata_ipc_read Message Size Error\n");
+         return false;
+      }
+      fd->p_recv_message = message;
+      fd->statistics.messages_received++;
+      fd->statistics.bytes_received += retval;
    }
    return true;
 }
 
-bool edgedata_ipc_write(EDGEDATA_IPC_FD* fd)
+/* server connection: the transport takes what it can without waiting, the rest is queued for the server loop */
+static bool edgedata_ipc_queue_write(EDGEDATA_IPC_FD* fd, struct iovec* iov, uint32_t iov_len, uint32_t full_msg_len)
+{
+   uint32_t written = 0;
+   uint64_t counter = 1;
+   if (fd->b_send_failed)
+   {
+      return false;
+   }
+   if (fd->send_queue_start == fd->send_queue.size())
+   {  /* nothing queued, write directly (the write function may modify iov) */
+      struct iovec sent[2];
+      int32_t retval;
+      memcpy(sent, iov, iov_len * sizeof(struct iovec));
+      retval = fd->write((void*)fd, sent, iov_len);
+      if (retval < 0)
+      {
+         return false;
+      }
+      written = retval;
+      if (written == full_msg_len)
+      {
+         return true;
+      }
+      fd->send_progress_ms = edgedata_time_ms();
+   }
+   if ((fd->send_queue.size() - fd->send_queue_start + full_msg_len - written) > SERVER_SEND_QUEUE_MAX)
+   {
+      ERROR_LOG("Server send queue overflow\n");
+      fd->b_send_failed = true;
+   }
+   else
+   {
+      for (uint32_t i = 0; i < iov_len; i++)
+      {
+         uint32_t skip = (written < iov[i].iov_len) ? written : iov[i].iov_len;
+         fd->send_queue.insert(fd->send_queue.end(), (unsigned char*)iov[i].iov_base + skip, (unsigned char*)iov[i].iov_base + iov[i].iov_len);
+         written -= skip;
+      }
+   }
+   if (!fd->b_send_queued.exchange(true))
+   {
+      (void)write(fd->server_wake_fd, &counter, sizeof(counter));
+   }
+   return !fd->b_send_failed;
+}
+
+/* server loop: sends queued messages as far as the transport takes them, false -> close the connection */
+static bool edgedata_ipc_queue_flush(EDGEDATA_IPC_FD* fd)
+{
+   bool ret = true;
+   struct iovec iov;
+   ENTER_CRITICAL_SECTION(fd);
+   while ((fd->b_connected) && (!fd->b_send_failed) && (fd->send_queue_start < fd->send_queue.size()))
+   {
+      uint32_t len = fd->send_queue.size() - fd->send_queue_start;
+      int32_t retval;
+      if (!fd->b_channel_type_stream)
+      {  /* message channel: one message per write */
+         EDGEDATA_RPC_HEADER header;
+         memcpy(&header, &fd->send_queue[fd->send_queue_start], sizeof(header));
+         len = sizeof(header) + header.msg_payload_len;
+      }
+      iov.iov_base = &fd->send_queue[fd->send_queue_start];
+      iov.iov_len = len;
+      retval = fd->write((void*)fd, &iov, 1);
+      if (retval < 0)
+      {
+         fd->b_send_failed = true;
+         break;
+      }
+      if (retval > 0)
+      {
+         fd->send_queue_start += retval;
+         fd->send_progress_ms = edgedata_time_ms();
+      }
+      if ((uint32_t)retval < len)
+      {
+         break;
+      }
+   }
+   if ((!fd->b_connected) || (fd->b_send_failed))
+   {
+      ret = false;
+   }
+   else if (fd->send_queue_start == fd->send_queue.size())
+   {
+      fd->send_queue.clear();
+      fd->send_queue_start = 0;
+      fd->b_send_queued = false;
+   }
+   else if ((edgedata_time_ms() - fd->send_progress_ms) >= SERVER_SEND_QUEUE_TIMEOUT_MS)
+   {
+      ERROR_LOG("Server connection send timeout\n");
+      ret = false;
+   }
+   else if (fd->send_queue_start >= (fd->send_queue.size() / 2))
+   {  /* keep the capacity, drop the sent front */
+      fd->send_queue.erase(fd->send_queue.begin(), fd->send_queue.begin() + fd->send_queue_start);
+      fd->send_queue_start = 0;
+   }
+   LEAVE_CRITICAL_SECTION(fd);
+   return ret;
+}
+
+/* header and payload are written from their own buffers (no staging copy) */
+bool edgedata_ipc_write(EDGEDATA_IPC_FD* fd, unsigned char* payload)
 {
    int32_t full_msg_len;
+   struct iovec iov[2];
    if (fd == NULL)
    {
       return false;
    }
-   full_msg_len = fd->send_message.header.msg_payload_len + sizeof(fd->send_message.header);
-   DEBUG_IPC_LOG("Full Message Len: %d, Header Len: %d, Payload Len: %d\n", full_msg_len, (int32_t)sizeof(fd->send_message.header), (int32_t)fd->send_message.header.msg_payload_len);
+   full_msg_len = fd->send_header.msg_payload_len + sizeof(fd->send_header);
+   DEBUG_IPC_LOG("Full Message Len: %d, Header Len: %d, Payload Len: %d\n", full_msg_len, (int32_t)sizeof(fd->send_header), (int32_t)fd->send_header.msg_payload_len);
+   iov[0].iov_base = (void*)&fd->send_header;
+   iov[0].iov_len = sizeof(fd->send_header);
+   iov[1].iov_base = (void*)payload;
+   iov[1].iov_len = fd->send_header.msg_payload_len;
    /* write full message */
-   if (fd->write(fd->write_fd, (void*)&fd->send_message, full_msg_len) != full_msg_len)
+   if ((fd->b_send_queue) ? (!edgedata_ipc_queue_write(fd, iov, 2, full_msg_len)) : (fd->write((void*)fd, iov, 2) != full_msg_len))
    {
       ERROR_LOG("edgedata_rpc_ipc_write Write Error\n");
       return false;
    }
+   fd->statistics.messages_sent++;
+   fd->statistics.bytes_sent += full_msg_len;
    return true;
 }
 
-static int32_t edgedata_ipc_basic_read(int32_t fd, void* buff, uint32_t buff_len)
+static int32_t edgedata_ipc_basic_read(void* fd, void* buff, uint32_t buff_len)
 {
-   return read(fd, buff, buff_len);
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   if (m_fd->b_spinning)
+   {
+      return recv(m_fd->read_fd, buff, buff_len, MSG_DONTWAIT);
+   }
+   return read(m_fd->read_fd, buff, buff_len);
 }
 
-static int32_t edgedata_ipc_basic_write(int32_t fd, void* buff, uint32_t buff_len)
+/* writes all vectors, a stream socket may accept only a part per call (server connection: returns what was taken) */
+static int32_t edgedata_ipc_basic_write(void* fd, struct iovec* iov, uint32_t iov_len)
 {
-   return write(fd, buff, buff_len);
-}
-
-/* *********** FIFO *******************
-
-
-// Server Connect
-EDGEDATA_IPC_FD *edgedata_ipc_fifo_server_listen(const char* channel_name)
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   int32_t written = 0;
+   while (iov_len > 0)
    {
-   EDGEDATA_IPC_FD *fd = ipc_new_fd(true);
-   fd->read_channel_name = string(channel_name) + "_client";
-   fd->write_channel_name = string(channel_name) + "_server";
-   fd->read = edgedata_ipc_fifo_read;
-   fd->write = edgedata_ipc_fifo_write;
-
-   mkfifo(fd->write_channel_name.c_str(), 0666);
-   mkfifo(fd->read_channel_name.c_str(), 0666);
-
-   fd->write_fd = open(fd->write_channel_name.c_str(), O_WRONLY);
-   fd->read_fd  = open(fd->read_channel_name.c_str(), O_RDONLY);// | O_NONBLOCK);
-   // if error
-   if ((fd->read_fd == 0) || (fd->write_fd == 0))
+      ssize_t retval = writev(m_fd->write_fd, iov, iov_len);
+      if (retval < 0)
       {
-      ERROR_LOG("Error open fifo server\n");
-      delete fd;
-      fd = NULL;
-      return NULL;
+         if (errno == EINTR)
+         {
+            continue;
+         }
+         if ((m_fd->b_send_queue) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+         {  /* the caller queues the rest */
+            return written;
+         }
+         if ((m_fd->b_nonblocking) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+         {  /* non blocking receive loop socket: same send timeout as SO_SNDTIMEO */
+            struct pollfd pfd;
+            pfd.fd = m_fd->write_fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, SOCKET_TIMEOUT_SECONDS * 1000) > 0)
+            {
+               continue;
+            }
+         }
+         return -1;
+      }
+      written += retval;
+      while ((iov_len > 0) && ((size_t)retval >= iov->iov_len))
+      {
+         retval -= iov->iov_len;
+         iov++;
+         iov_len--;
+      }
+      if (iov_len > 0)
+      {
+         iov->iov_base = (unsigned char*)iov->iov_base + retval;
+         iov->iov_len -= retval;
       }
-   return fd;
    }
+   return written;
+}
 
-
-// Client Connect
-EDGEDATA_IPC_FD *edgedata_ipc_fifo_client_connect(const char* channel_name)
+/* basic read, but keeps file descriptors passed by the peer (SCM_RIGHTS) */
+static int32_t edgedata_ipc_unix_read(void* fd, void* buff, uint32_t buff_len)
+{
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   struct msghdr msg;
+   struct iovec iov;
+   union {
+      struct cmsghdr align;
+      char buff[CMSG_SPACE(sizeof(m_fd->received_fds))];
+   } control;
+
+   memset(&msg, 0, sizeof(msg));
+   iov.iov_base = buff;
+   iov.iov_len = buff_len;
+   msg.msg_iov = &iov;
+   msg.msg_iovlen = 1;
+   msg.msg_control = control.buff;
+   msg.msg_controllen = sizeof(control.buff);
+
+   int32_t retval = recvmsg(m_fd->read_fd, &msg, MSG_CMSG_CLOEXEC | (m_fd->b_spinning ? MSG_DONTWAIT : 0));
+   if (retval <= 0)
    {
-   EDGEDATA_IPC_FD *fd = ipc_new_fd(true);
-   fd->read_channel_name = string(channel_name) + "_server";
-   fd->write_channel_name = string(channel_name) + "_client";
-   fd->read = edgedata_ipc_fifo_read;
-   fd->write = edgedata_ipc_fifo_write;
-
-   fd->write_fd = open(fd->write_channel_name.c_str(), O_WRONLY);
-   fd->read_fd  = open(fd->read_channel_name.c_str(), O_RDONLY);// | O_NONBLOCK);
-   // if error
-   if ((fd->read_fd == 0) || (fd->write_fd == 0))
+      return retval;
+   }
+   for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+   {
+      if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS))
       {
-      ERROR_LOG("Error open fifo client\n");
-      delete fd;
-      fd = NULL;
-      return NULL;
+         uint32_t fds_len = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int32_t);
+         for (uint32_t i = 0; i < fds_len; i++)
+         {
+            int32_t received_fd;
+            memcpy(&received_fd, CMSG_DATA(cmsg) + (i * sizeof(int32_t)), sizeof(int32_t));
+            if (m_fd->received_fds_len < (sizeof(m_fd->received_fds) / sizeof(m_fd->received_fds[0])))
+            {
+               m_fd->received_fds[m_fd->received_fds_len++] = received_fd;
+            }
+            else
+            {
+               close(received_fd);
+            }
+         }
       }
-   return fd;
    }
-*/
-
-/* *********** UNIX ******************* */
-//void pipe_close_handler(int s) {
-//ERROR_LOG("Caught SIGPIPE SIGNAL ERROR\n");
-//}
+   return retval;
+}
 
+/* *********** SHARED MEMORY ********** */
+/* Two single producer single consumer rings in a memfd, one per direction.      */
+/* The unix socket stays open as control channel (setup and hang up detection). */
 
-EDGEDATA_IPC_FD* edgedata_ipc_unix_server_listen_with_error_cb(const char* channel_name, const char* user, fct_error_connection cb)
+static void edgedata_ipc_shm_free(EDGEDATA_SHM_TRANSPORT** shm)
 {
-   EDGEDATA_IPC_FD* fd = edgedata_ipc_unix_server_listen(channel_name, user);
-   if (fd != NULL)
+   if (*shm == NULL)
    {
-      fd->error_connection_cb = cb;
+      return;
    }
-   return fd;
+   if ((*shm)->area != NULL)
+   {
+      munmap((*shm)->area, sizeof(EDGEDATA_SHM_AREA));
+   }
+   if ((*shm)->mem_fd >= 0)
+   {
+      close((*shm)->mem_fd);
+   }
+   if ((*shm)->recv_event_fd >= 0)
+   {
+      close((*shm)->recv_event_fd);
+   }
+   if ((*shm)->send_event_fd >= 0)
+   {
+      close((*shm)->send_event_fd);
+   }
+   if ((*shm)->send_space_fd >= 0)
+   {
+      close((*shm)->send_space_fd);
+   }
+   if ((*shm)->recv_space_fd >= 0)
+   {
+      close((*shm)->recv_space_fd);
+   }
+   delete (*shm);
+   *shm = NULL;
 }
 
-EDGEDATA_IPC_FD* edgedata_ipc_unix_server_listen(const char* channel_name, const char* user)
+/* fds: memfd, data client to server, data server to client, space client to server, space server to client */
+static EDGEDATA_SHM_TRANSPORT* edgedata_ipc_shm_map(int32_t* fds, bool b_server)
 {
-   int32_t listen_socket;
-   struct timeval tv;
-   char cmd[256];
-
-   EDGEDATA_IPC_FD* fd = ipc_new_fd(true);
-   tv.tv_sec = SOCKET_TIMEOUT_SECONDS;
-   tv.tv_usec = 0;
-   fd->read_channel_name = string(channel_name);
-   fd->write_channel_name = string(channel_name);
-   fd->read = edgedata_ipc_basic_read;
-   fd->write = edgedata_ipc_basic_write;
-   fd->error_connection_cb = NULL;
-   /* catch SIGPIPE error */
-   signal(SIGPIPE, SIG_IGN); //pipe_close_handler);  // SIG_IGN ignores it
-
-   listen_socket = socket(AF_LOCAL, SOCK_STREAM, 0);
-
-   if (listen_socket < 0)
+   EDGEDATA_SHM_TRANSPORT* shm = new EDGEDATA_SHM_TRANSPORT();
+   shm->mem_fd = fds[0];
+   shm->recv_event_fd = b_server ? fds[1] : fds[2];
+   shm->send_event_fd = b_server ? fds[2] : fds[1];
+   shm->send_space_fd = b_server ? fds[4] : fds[3];
+   shm->recv_space_fd = b_server ? fds[3] : fds[4];
+   shm->area = (EDGEDATA_SHM_AREA*)mmap(NULL, sizeof(EDGEDATA_SHM_AREA), PROT_READ | PROT_WRITE, MAP_SHARED, shm->mem_fd, 0);
+   if (shm->area == MAP_FAILED)
    {
-      edgedata_data_cleanup(&fd);
-      ERROR_LOG("Error create unix socket\n");
+      ERROR_LOG("Error map shared memory\n");
+      shm->area = NULL;
+      edgedata_ipc_shm_free(&shm);
       return NULL;
    }
-
-   struct sockaddr_un addr;
-   memset(&addr, 0, sizeof(addr));
-   addr.sun_family = AF_LOCAL;
-   if (fd->read_channel_name.length() >= sizeof(addr.sun_path))
+   if (b_server)
    {
-      edgedata_data_cleanup(&fd);
-      ERROR_LOG("Error: channel name too long for unix socket path\n");
-      return NULL;
+      shm->recv_ring = &shm->area->client_to_server;
+      shm->send_ring = &shm->area->server_to_client;
    }
-   strncpy(addr.sun_path, fd->read_channel_name.c_str(), sizeof(addr.sun_path) - 1);
-   addr.sun_path[sizeof(addr.sun_path) - 1] = '\0';
-
-   /* Only unlink if path is a socket or does not exist */
-   struct stat st;
-   if (lstat(fd->read_channel_name.c_str(), &st) == 0)
+   else
    {
-      if (S_ISSOCK(st.st_mode))
-      {
-         unlink(fd->read_channel_name.c_str());
-      }
-      else
-      {
-         close(listen_socket);
-         edgedata_data_cleanup(&fd);
-         ERROR_LOG("Error: path exists and is not a socket: %s\n", addr.sun_path);
-         return NULL;
-      }
+      shm->recv_ring = &shm->area->server_to_client;
+      shm->send_ring = &shm->area->client_to_server;
+   }
+   return shm;
+}
+
+static int32_t edgedata_ipc_shm_read(void* fd, void* buff, uint32_t buff_len)
+{
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   EDGEDATA_SHM_RING* ring = m_fd->shm->recv_ring;
+   uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+   uint32_t available = ring->head.load(std::memory_order_acquire) - tail;
+   uint32_t pos;
+   uint32_t first_len;
+
+   if (buff_len == 0)
+   {
+      return 0;
+   }
+   while (available == 0)
+   {
+      if (m_fd->b_spinning)
+      {  /* busy poll: only the ring is checked, no system call */
+         errno = EAGAIN;
+         return -1;
+      }
+      /* announce sleep before the final check, the producer only signals waiting consumers */
+      ring->consumer_waiting.store(1, std::memory_order_seq_cst);
+      if ((m_fd->b_nonblocking) && (ring->head.load(std::memory_order_seq_cst) == tail))
+      {  /* server loop: consumer_waiting stays set, the event fd is part of the epoll set */
+         struct pollfd pfd;
+         uint64_t counter;
+         (void)read(m_fd->shm->recv_event_fd, &counter, sizeof(counter));
+         int32_t retval;
+         pfd.fd = m_fd->read_fd;
+         pfd.events = POLLIN;
+         pfd.revents = 0;
+         do
+         {
+            retval = poll(&pfd, 1, 0);
+         } while ((retval < 0) && (errno == EINTR));
+         if (retval < 0)
+         {
+            return -1;
+         }
+         if (retval > 0)
+         {  /* nothing is sent on the control channel after setup -> peer closed */
+            return 0;
+         }
+         if (ring->head.load(std::memory_order_seq_cst) == tail)
+         {
+            errno = EAGAIN;
+            return -1;
+         }
+      }
+      if (ring->head.load(std::memory_order_seq_cst) == tail)
+      {
+         struct pollfd pfd[2];
+         pfd[0].fd = m_fd->shm->recv_event_fd;
+         pfd[0].events = POLLIN;
+         pfd[0].revents = 0;
+         pfd[1].fd = m_fd->read_fd;
+         pfd[1].events = POLLIN;
+         pfd[1].revents = 0;
+         int32_t retval = poll(pfd, 2, SOCKET_TIMEOUT_SECONDS * 1000);
+         if ((retval < 0) && (errno != EINTR))
+         {
+            ring->consumer_waiting.store(0, std::memory_order_relaxed);
+            return -1;
+         }
+         if (retval == 0)
+         {  /* same behaviour as SO_RCVTIMEO on the unix socket */
+            ring->consumer_waiting.store(0, std::memory_order_relaxed);
+            errno = EAGAIN;
+            return -1;
+         }
+         if (pfd[1].revents != 0)
+         {  /* nothing is sent on the control channel after setup -> peer closed */
+            ring->consumer_waiting.store(0, std::memory_order_relaxed);
+            return 0;
+         }
+         if ((pfd[0].revents & POLLIN) != 0)
+         {
+            uint64_t counter;
+            (void)read(m_fd->shm->recv_event_fd, &counter, sizeof(counter));
+         }
+      }
+      ring->consumer_waiting.store(0, std::memory_order_relaxed);
+      available = ring->head.load(std::memory_order_acquire) - tail;
+   }
+
+   if (buff_len > available)
+   {
+      buff_len = available;
+   }
+   pos = tail & (SHM_RING_SIZE - 1);
+   first_len = SHM_RING_SIZE - pos;
+   if (first_len > buff_len)
+   {
+      first_len = buff_len;
+   }
+   memcpy(buff, &ring->data[pos], first_len);
+   memcpy((unsigned char*)buff + first_len, &ring->data[0], buff_len - first_len);
+   ring->tail.store(tail + buff_len, std::memory_order_seq_cst);
+   /* wake up producer only if it waits for space */
+   if (ring->producer_waiting.load(std::memory_order_seq_cst) != 0)
+   {
+      uint64_t counter = 1;
+      (void)write(m_fd->shm->recv_space_fd, &counter, sizeof(counter));
+   }
+   return buff_len;
+}
+
+/* called within critical section -> single producer */
+static int32_t edgedata_ipc_shm_write(void* fd, struct iovec* iov, uint32_t iov_len)
+{
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   EDGEDATA_SHM_RING* ring = m_fd->shm->send_ring;
+   uint32_t head = ring->head.load(std::memory_order_relaxed);
+   int64_t deadline_ms = 0;
+   uint32_t buff_len = 0;
+   uint32_t offset = 0;
+   uint32_t pos;
+   uint32_t first_len;
+
+   for (uint32_t i = 0; i < iov_len; i++)
+   {
+      buff_len += iov[i].iov_len;
+   }
+   if (m_fd->b_send_queue)
+   {  /* server connection: publish what fits, the caller queues the rest */
+      uint32_t free_len = SHM_RING_SIZE - (head - ring->tail.load(std::memory_order_acquire));
+      if (buff_len > free_len)
+      {
+         buff_len = free_len;
+      }
+   }
+   if (buff_len > SHM_RING_SIZE)
+   {
+      return -1;
+   }
+   /* publish buff_len at once (a client publishes whole messages), wait for the consumer if the ring is full */
+   while ((SHM_RING_SIZE - (head - ring->tail.load(std::memory_order_acquire))) < buff_len)
+   {
+      struct pollfd pfd[2];
+      int64_t now = edgedata_time_ms();
+      int32_t retval;
+      if (deadline_ms == 0)
+      {
+         deadline_ms = now + (SOCKET_TIMEOUT_SECONDS * 1000);
+      }
+      if (now >= deadline_ms)
+      {
+         ring->producer_waiting.store(0, std::memory_order_relaxed);
+         ERROR_LOG("edgedata_ipc_shm_write ring full timeout\n");
+         return -1;
+      }
+      /* announce sleep before the final check, the consumer only signals waiting producers */
+      ring->producer_waiting.store(1, std::memory_order_seq_cst);
+      if ((SHM_RING_SIZE - (head - ring->tail.load(std::memory_order_seq_cst))) >= buff_len)
+      {
+         break;
+      }
+      pfd[0].fd = m_fd->shm->send_space_fd;
+      pfd[0].events = POLLIN;
+      pfd[0].revents = 0;
+      pfd[1].fd = m_fd->read_fd;
+      pfd[1].events = POLLIN;
+      pfd[1].revents = 0;
+      retval = poll(pfd, 2, (int32_t)(deadline_ms - now));
+      if ((retval < 0) && (errno != EINTR))
+      {
+         ring->producer_waiting.store(0, std::memory_order_relaxed);
+         return -1;
+      }
+      if ((retval > 0) && (pfd[1].revents != 0))
+      {  /* nothing is sent on the control channel after setup -> peer closed */
+         ring->producer_waiting.store(0, std::memory_order_relaxed);
+         return -1;
+      }
+      if ((retval > 0) && ((pfd[0].revents & POLLIN) != 0))
+      {
+         uint64_t counter;
+         (void)read(m_fd->shm->send_space_fd, &counter, sizeof(counter));
+      }
+   }
+   ring->producer_waiting.store(0, std::memory_order_relaxed);
+   for (uint32_t i = 0; (i < iov_len) && (offset < buff_len); i++)
+   {
+      uint32_t len = (iov[i].iov_len < (buff_len - offset)) ? iov[i].iov_len : (buff_len - offset);
+      pos = (head + offset) & (SHM_RING_SIZE - 1);
+      first_len = SHM_RING_SIZE - pos;
+      if (first_len > len)
+      {
+         first_len = len;
+      }
+      memcpy(&ring->data[pos], iov[i].iov_base, first_len);
+      memcpy(&ring->data[0], (unsigned char*)iov[i].iov_base + first_len, len - first_len);
+      offset += len;
+   }
+   if (buff_len == 0)
+   {
+      return 0;
+   }
+   ring->head.store(head + buff_len, std::memory_order_seq_cst);
+   /* wake up consumer only if it is going to sleep */
+   if (ring->consumer_waiting.load(std::memory_order_seq_cst) != 0)
+   {
+      uint64_t counter = 1;
+      (void)write(m_fd->shm->send_event_fd, &counter, sizeof(counter));
+   }
+   return buff_len;
+}
+
+static void edgedata_ipc_shm_activate(EDGEDATA_IPC_FD* fd, EDGEDATA_SHM_TRANSPORT* shm)
+{
+   fd->shm = shm;
+   fd->b_channel_type_stream = true;   /* rings are byte streams, also with a SOCK_SEQPACKET control channel */
+   fd->read = edgedata_ipc_shm_read;
+   fd->write = edgedata_ipc_shm_write;
+   DEBUG_IPC_LOG("Shared memory transport activated\n");
+}
+
+/* *********** IO_URING *************** */
+/* Receive side only: one multishot recv stays armed on the socket and fills provided */
+/* buffers, a read call takes completed buffers without a system call.                */
+
+#if ENABLE_IO_URING != 0
+
+static void edgedata_ipc_uring_free(EDGEDATA_URING** uring)
+{
+   if (*uring == NULL)
+   {
+      return;
+   }
+   /* closing the ring cancels the armed recv before the buffers are unmapped */
+   if ((*uring)->ring_fd >= 0)
+   {
+      close((*uring)->ring_fd);
+   }
+   if ((*uring)->sqes != NULL)
+   {
+      munmap((*uring)->sqes, (*uring)->sqes_size);
+   }
+   if (((*uring)->cq_ring != NULL) && ((*uring)->cq_ring != (*uring)->sq_ring))
+   {
+      munmap((*uring)->cq_ring, (*uring)->cq_ring_size);
+   }
+   if ((*uring)->sq_ring != NULL)
+   {
+      munmap((*uring)->sq_ring, (*uring)->sq_ring_size);
+   }
+   if ((*uring)->buf_ring != NULL)
+   {
+      munmap((*uring)->buf_ring, URING_BUFFER_COUNT * sizeof(struct io_uring_buf));
+   }
+   if ((*uring)->buffers != NULL)
+   {
+      munmap((*uring)->buffers, URING_BUFFER_COUNT * URING_BUFFER_SIZE);
+   }
+   delete (*uring);
+   *uring = NULL;
+}
+
+static void edgedata_ipc_uring_recycle(EDGEDATA_URING* uring, uint16_t bid)
+{
+   /* io_uring_buf_ring::bufs is not used, its empty struct member has size 1 in C++ */
+   struct io_uring_buf* bufs = (struct io_uring_buf*)uring->buf_ring;
+   uint16_t tail = uring->buf_ring->tail;
+   struct io_uring_buf* buf = &bufs[tail & (URING_BUFFER_COUNT - 1)];
+   buf->addr = (uint64_t)(uintptr_t)&uring->buffers[bid * URING_BUFFER_SIZE];
+   buf->len = URING_BUFFER_SIZE;
+   buf->bid = bid;
+   __atomic_store_n(&uring->buf_ring->tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+}
+
+static void edgedata_ipc_uring_arm(EDGEDATA_IPC_FD* fd)
+{
+   EDGEDATA_URING* uring = fd->uring;
+   uint32_t tail = *uring->sq_tail;
+   uint32_t index = tail & uring->sq_mask;
+   struct io_uring_sqe* sqe = &uring->sqes[index];
+
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->opcode = IORING_OP_RECV;
+   sqe->fd = fd->read_fd;
+   sqe->flags = IOSQE_BUFFER_SELECT;
+   sqe->ioprio = IORING_RECV_MULTISHOT;
+   sqe->buf_group = URING_BUFFER_GROUP;
+   uring->sq_array[index] = index;
+   __atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+   uring->to_submit++;
+   uring->b_armed = true;
+}
+
+static int32_t edgedata_ipc_uring_read(void* fd, void* buff, uint32_t buff_len)
+{
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   EDGEDATA_URING* uring = m_fd->uring;
+   uint32_t len;
+
+   if (buff_len == 0)
+   {
+      return 0;
+   }
+   while (!uring->b_pending)
+   {
+      uint32_t head = *uring->cq_head;
+      if (head == __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE))
+      {  /* no completion, submit (re-arm) and wait with the usual socket timeout */
+         struct __kernel_timespec ts;
+         struct io_uring_getevents_arg arg;
+         if (!uring->b_armed)
+         {
+            edgedata_ipc_uring_arm(m_fd);
+         }
+         if ((m_fd->b_spinning) || (m_fd->b_nonblocking))
+         {  /* busy poll or receive loop: only submit a re-arm, the ring fd becomes readable with the next completion */
+            if ((uring->to_submit > 0) && (syscall(__NR_io_uring_enter, uring->ring_fd, uring->to_submit, 0, 0, NULL, 0) > 0))
+            {
+               uring->to_submit = 0;
+            }
+            errno = EAGAIN;
+            return -1;
+         }
+         ts.tv_sec = SOCKET_TIMEOUT_SECONDS;
+         ts.tv_nsec = 0;
+         memset(&arg, 0, sizeof(arg));
+         arg.ts = (uint64_t)(uintptr_t)&ts;
+         int32_t retval = syscall(__NR_io_uring_enter, uring->ring_fd, uring->to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+         if (retval < 0)
+         {
+            if (errno == ETIME)
+            {  /* same behaviour as SO_RCVTIMEO */
+               errno = EAGAIN;
+            }
+            return -1;
+         }
+         uring->to_submit -= (retval < (int32_t)uring->to_submit) ? retval : uring->to_submit;
+         continue;
+      }
+      struct io_uring_cqe* cqe = &uring->cqes[head & uring->cq_mask];
+      int32_t res = cqe->res;
+      uint32_t flags = cqe->flags;
+      __atomic_store_n(uring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+      if ((flags & IORING_CQE_F_MORE) == 0)
+      {
+         uring->b_armed = false;
+      }
+      if (res == -ENOBUFS)
+      {  /* all buffers in use, re-armed with the next wait */
+         continue;
+      }
+      if ((res < 0) && (!uring->b_received))
+      {  /* e.g. multishot recv not supported by the kernel, nothing was consumed from the socket */
+         INFO_LOG("io_uring recv not supported (%d), use read()\n", res);
+         edgedata_ipc_uring_free(&m_fd->uring);
+         m_fd->read = edgedata_ipc_basic_read;
+         return m_fd->read(fd, buff, buff_len);
+      }
+      if (res < 0)
+      {
+         errno = -res;
+         return -1;
+      }
+      if (res == 0)
+      {  /* peer closed */
+         return 0;
+      }
+      uring->b_received = true;
+      uring->b_pending = true;
+      uring->pending_bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+      uring->pending_offset = 0;
+      uring->pending_len = res;
+   }
+
+   len = uring->pending_len - uring->pending_offset;
+   if (len > buff_len)
+   {
+      len = buff_len;
+   }
+   memcpy(buff, &uring->buffers[(uring->pending_bid * URING_BUFFER_SIZE) + uring->pending_offset], len);
+   m_fd->statistics.bytes_copied_recv += len;
+   uring->pending_offset += len;
+   if (uring->pending_offset == uring->pending_len)
+   {
+      uring->b_pending = false;
+      edgedata_ipc_uring_recycle(uring, uring->pending_bid);
+   }
+   return len;
+}
+
+/* switches the receive side of fd to io_uring, false -> fd keeps its read function */
+static bool edgedata_ipc_uring_activate(EDGEDATA_IPC_FD* fd)
+{
+   struct io_uring_params params;
+   struct io_uring_buf_reg reg;
+   EDGEDATA_URING* uring = new EDGEDATA_URING();
+
+   memset(uring, 0, sizeof(EDGEDATA_URING));
+   memset(&params, 0, sizeof(params));
+   uring->ring_fd = syscall(__NR_io_uring_setup, URING_QUEUE_DEPTH, &params);
+   if ((uring->ring_fd < 0) || ((params.features & IORING_FEAT_EXT_ARG) == 0))
+   {
+      INFO_LOG("io_uring not available\n");
+      edgedata_ipc_uring_free(&uring);
+      return false;
+   }
+   uring->sq_ring_size = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+   uring->cq_ring_size = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+   if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+   {
+      if (uring->cq_ring_size > uring->sq_ring_size)
+      {
+         uring->sq_ring_size = uring->cq_ring_size;
+      }
+      uring->cq_ring_size = uring->sq_ring_size;
+   }
+   uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_SQ_RING);
+   if (uring->sq_ring == MAP_FAILED)
+   {
+      uring->sq_ring = NULL;
+   }
+   else if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+   {
+      uring->cq_ring = uring->sq_ring;
+   }
+   else
+   {
+      uring->cq_ring = mmap(NULL, uring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_CQ_RING);
+      uring->cq_ring = (uring->cq_ring == MAP_FAILED) ? NULL : uring->cq_ring;
+   }
+   uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+   uring->sqes = (struct io_uring_sqe*)mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_SQES);
+   uring->sqes = (uring->sqes == MAP_FAILED) ? NULL : uring->sqes;
+   uring->buf_ring = (struct io_uring_buf_ring*)mmap(NULL, URING_BUFFER_COUNT * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   uring->buf_ring = (uring->buf_ring == MAP_FAILED) ? NULL : uring->buf_ring;
+   uring->buffers = (unsigned char*)mmap(NULL, URING_BUFFER_COUNT * URING_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   uring->buffers = (uring->buffers == MAP_FAILED) ? NULL : uring->buffers;
+   if ((uring->sq_ring == NULL) || (uring->cq_ring == NULL) || (uring->sqes == NULL) || (uring->buf_ring == NULL) || (uring->buffers == NULL))
+   {
+      ERROR_LOG("Error map io_uring\n");
+      edgedata_ipc_uring_free(&uring);
+      return false;
+   }
+   uring->sq_head = (uint32_t*)((unsigned char*)uring->sq_ring + params.sq_off.head);
+   uring->sq_tail = (uint32_t*)((unsigned char*)uring->sq_ring + params.sq_off.tail);
+   uring->sq_array = (uint32_t*)((unsigned char*)uring->sq_ring + params.sq_off.array);
+   uring->sq_mask = *(uint32_t*)((unsigned char*)uring->sq_ring + params.sq_off.ring_mask);
+   uring->cq_head = (uint32_t*)((unsigned char*)uring->cq_ring + params.cq_off.head);
+   uring->cq_tail = (uint32_t*)((unsigned char*)uring->cq_ring + params.cq_off.tail);
+   uring->cq_mask = *(uint32_t*)((unsigned char*)uring->cq_ring + params.cq_off.ring_mask);
+   uring->cqes = (struct io_uring_cqe*)((unsigned char*)uring->cq_ring + params.cq_off.cqes);
+
+   /* provided buffer ring (kernel >= 5.19) */
+   memset(&reg, 0, sizeof(reg));
+   reg.ring_addr = (uint64_t)(uintptr_t)uring->buf_ring;
+   reg.ring_entries = URING_BUFFER_COUNT;
+   reg.bgid = URING_BUFFER_GROUP;
+   if (syscall(__NR_io_uring_register, uring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+   {
+      INFO_LOG("io_uring provided buffers not available\n");
+      edgedata_ipc_uring_free(&uring);
+      return false;
+   }
+   for (uint16_t bid = 0; bid < URING_BUFFER_COUNT; bid++)
+   {
+      edgedata_ipc_uring_recycle(uring, bid);
+   }
+   fd->uring = uring;
+   edgedata_ipc_uring_arm(fd);
+   fd->read = edgedata_ipc_uring_read;
+   DEBUG_IPC_LOG("io_uring receive activated\n");
+   return true;
+}
+
+#else
+
+static void edgedata_ipc_uring_free(EDGEDATA_URING** uring)
+{
+   if (*uring != NULL)
+   {
+      delete (*uring);
+      *uring = NULL;
+   }
+}
+
+static bool edgedata_ipc_uring_activate(EDGEDATA_IPC_FD* fd)
+{
+   INFO_LOG("io_uring not supported by this build\n");
+   return false;
+}
+
+#endif
+
+/* readable when a non blocking edgedata_ipc_read may continue (shared memory: recv_event_fd as well) */
+static int32_t edgedata_ipc_wait_fd(EDGEDATA_IPC_FD* fd)
+{
+#if ENABLE_IO_URING != 0
+   if (fd->uring != NULL)
+   {  /* the multishot recv consumes the socket, completions are signaled by the ring */
+      return fd->uring->ring_fd;
+   }
+#endif
+   return fd->read_fd;
+}
+
+/* *********** FIFO *******************
+
+
+// Server Connect
+EDGEDATA_IPC_FD *edgedata_ipc_fifo_server_listen(const char* channel_name)
+   {
+   EDGEDATA_IPC_FD *fd = ipc_new_fd(true);
+   fd->read_channel_name = string(channel_name) + "_client";
+   fd->write_channel_name = string(channel_name) + "_server";
+   fd->read = edgedata_ipc_fifo_read;
+   fd->write = edgedata_ipc_fifo_write;
+
+   mkfifo(fd->write_channel_name.c_str(), 0666);
+   mkfifo(fd->read_channel_name.c_str(), 0666);
+
+   fd->write_fd = open(fd->write_channel_name.c_str(), O_WRONLY);
+   fd->read_fd  = open(fd->read_channel_name.c_str(), O_RDONLY);// | O_NONBLOCK);
+   // if error
+   if ((fd->read_fd == 0) || (fd->write_fd == 0))
+      {
+      ERROR_LOG("Error open fifo server\n");
+      delete fd;
+      fd = NULL;
+      return NULL;
+      }
+   return fd;
+   }
+
+
+// Client Connect
+EDGEDATA_IPC_FD *edgedata_ipc_fifo_client_connect(const char* channel_name)
+   {
+   EDGEDATA_IPC_FD *fd = ipc_new_fd(true);
+   fd->read_channel_name = string(channel_name) + "_server";
+   fd->write_channel_name = string(channel_name) + "_client";
+   fd->read = edgedata_ipc_fifo_read;
+   fd->write = edgedata_ipc_fifo_write;
+
+   fd->write_fd = open(fd->write_channel_name.c_str(), O_WRONLY);
+   fd->read_fd  = open(fd->read_channel_name.c_str(), O_RDONLY);// | O_NONBLOCK);
+   // if error
+   if ((fd->read_fd == 0) || (fd->write_fd == 0))
+      {
+      ERROR_LOG("Error open fifo client\n");
+      delete fd;
+      fd = NULL;
+      return NULL;
+      }
+   return fd;
+   }
+*/
+
+/* *********** UNIX ******************* */
+//void pipe_close_handler(int s) {
+//ERROR_LOG("Caught SIGPIPE SIGNAL ERROR\n");
+//}
+
+
+EDGEDATA_IPC_FD* edgedata_ipc_unix_server_listen_with_error_cb(const char* channel_name, const char* user, fct_error_connection cb)
+{
+   EDGEDATA_IPC_FD* fd = edgedata_ipc_unix_server_listen(channel_name, user);
+   if (fd != NULL)
+   {
+      fd->error_connection_cb = cb;
+   }
+   return fd;
+}
+
+/* creates the listen socket (bind, permissions, listen), returns -1 on error */
+static int32_t ipc_unix_listen_socket(const char* channel_name, const char* user, bool b_stream_channel, int32_t backlog)
+{
+   int32_t listen_socket = socket(AF_LOCAL, (b_stream_channel) ? SOCK_STREAM : SOCK_SEQPACKET, 0);
+
+   if (listen_socket < 0)
+   {
+      ERROR_LOG("Error create unix socket\n");
+      return -1;
+   }
+
+   struct sockaddr_un addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_LOCAL;
+   if (strlen(channel_name) >= sizeof(addr.sun_path))
+   {
+      close(listen_socket);
+      ERROR_LOG("Error: channel name too long for unix socket path\n");
+      return -1;
+   }
+   strncpy(addr.sun_path, channel_name, sizeof(addr.sun_path) - 1);
+   addr.sun_path[sizeof(addr.sun_path) - 1] = '\0';
+
+   /* Only unlink if path is a socket or does not exist */
+   struct stat st;
+   if (lstat(channel_name, &st) == 0)
+   {
+      if (S_ISSOCK(st.st_mode))
+      {
+         unlink(channel_name);
+      }
+      else
+      {
+         close(listen_socket);
+         ERROR_LOG("Error: path exists and is not a socket: %s\n", addr.sun_path);
+         return -1;
+      }
    }
 
    if (bind(listen_socket, (struct sockaddr*) & addr, sizeof(addr)) < 0)
    {
-      close(listen_socket);
-      edgedata_data_cleanup(&fd);
-      ERROR_LOG("Error bind unix socket %s\n", addr.sun_path);
-      return NULL;
+      close(listen_socket);
+      ERROR_LOG("Error bind unix socket %s\n", addr.sun_path);
+      return -1;
+   }
+
+   /* we set permission here */
+   if (user != NULL)
+   {
+      struct passwd *pw = getpwnam(user);
+      if (pw != NULL)
+      {
+         (void)chown(addr.sun_path, pw->pw_uid, pw->pw_gid);
+      }
+      (void)chmod(addr.sun_path, 0777);
+   }
+
+   listen(listen_socket, backlog);
+   return listen_socket;
+}
+
+/* transport setup shared by the single and the multi client server */
+static void ipc_unix_server_fd_init(EDGEDATA_IPC_FD* fd, const char* channel_name)
+{
+   fd->read_channel_name = string(channel_name);
+   fd->write_channel_name = string(channel_name);
+   fd->read = edgedata_ipc_unix_read;
+   fd->write = edgedata_ipc_basic_write;
+   fd->error_connection_cb = NULL;
+   /* clients may upgrade to shared memory */
+   (void)edgedata_callback_with_reply_register(fd, MSG_TYPE_SHM_SETUP, edgedata_ipc_shm_setup_with_reply);
+   (void)edgedata_callback_with_reply_register(fd, MSG_TYPE_CAPABILITIES, edgedata_rpc_capabilities_with_reply);
+}
+
+EDGEDATA_IPC_FD* edgedata_ipc_unix_server_listen(const char* channel_name, const char* user)
+{
+   int32_t listen_socket;
+   struct timeval tv;
+   struct sockaddr_un addr;
+
+   EDGEDATA_IPC_FD* fd = ipc_new_fd(!edgedata_ipc_config.b_seqpacket);
+   tv.tv_sec = SOCKET_TIMEOUT_SECONDS;
+   tv.tv_usec = 0;
+   ipc_unix_server_fd_init(fd, channel_name);
+   /* catch SIGPIPE error */
+   signal(SIGPIPE, SIG_IGN); //pipe_close_handler);  // SIG_IGN ignores it
+
+   listen_socket = ipc_unix_listen_socket(channel_name, user, fd->b_channel_type_stream, 5);
+   if (listen_socket < 0)
+   {
+      edgedata_data_cleanup(&fd);
+      return NULL;
+   }
+
+   socklen_t addrlen = sizeof(addr);
+   fd->write_fd = accept(listen_socket,
+      (struct sockaddr*) & addr,
+      &addrlen);
+
+   close(listen_socket);
+   if (fd->write_fd <= 0)
+   {
+      edgedata_data_cleanup(&fd);
+      ERROR_LOG("Error accept unix socket\n");
+      return NULL;
+   }
+   fd->read_fd = fd->write_fd;
+
+   /* set read socket timeout */
+   setsockopt(fd->read_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
+   setsockopt(fd->read_fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof tv);
+   return fd;
+}
+
+/* transport setup shared by the unix socket and the loopback client */
+static void ipc_unix_client_fd_init(EDGEDATA_IPC_FD* fd, const char* channel_name)
+{
+   fd->read_channel_name = string(channel_name);
+   fd->write_channel_name = string(channel_name);
+   fd->read = edgedata_ipc_basic_read;
+   fd->write = edgedata_ipc_basic_write;
+   fd->error_connection_cb = NULL;
+}
+
+EDGEDATA_IPC_FD* edgedata_ipc_unix_client_connect(const char* channel_name)
+{
+   EDGEDATA_IPC_FD* fd = ipc_new_fd(!edgedata_ipc_config.b_seqpacket);
+   struct timeval tv;
+   tv.tv_sec = SOCKET_TIMEOUT_SECONDS;
+   tv.tv_usec = 0;
+   ipc_unix_client_fd_init(fd, channel_name);
+
+   //catch SIGPIPE error
+   signal(SIGPIPE, SIG_IGN);//pipe_close_handler);  // SIG_IGN ignores it
+
+   struct sockaddr_un addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_LOCAL;
+   if (fd->read_channel_name.length() >= sizeof(addr.sun_path))
+   {
+      edgedata_data_cleanup(&fd);
+      ERROR_LOG("Error: channel name too long for unix socket path\n");
+      return NULL;
+   }
+   strncpy(addr.sun_path, fd->read_channel_name.c_str(), sizeof(addr.sun_path) - 1);
+   addr.sun_path[sizeof(addr.sun_path) - 1] = '\0';
+
+   while (true)
+   {
+      fd->write_fd = socket(PF_LOCAL, (fd->b_channel_type_stream) ? SOCK_STREAM : SOCK_SEQPACKET, 0);
+      fd->read_fd = fd->write_fd;
+
+      if (fd->write_fd < 0)
+      {
+         edgedata_data_cleanup(&fd);
+         ERROR_LOG("Error create unix socket\n");
+         return NULL;
+      }
+      if (connect(fd->read_fd, (struct sockaddr*) & addr, sizeof(addr)) == 0)
+      {
+         break;
+      }
+      int32_t connect_errno = errno;
+      close(fd->read_fd);
+      if ((!fd->b_channel_type_stream) && (connect_errno == EPROTOTYPE))
+      {  /* server listens with SOCK_STREAM */
+         INFO_LOG("SOCK_SEQPACKET not supported by server, use SOCK_STREAM\n");
+         fd->b_channel_type_stream = true;
+         continue;
+      }
+      edgedata_data_cleanup(&fd);
+      ERROR_LOG("Error connect unix socket\n");
+      return NULL;
+   }
+   setsockopt(fd->read_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
+   setsockopt(fd->read_fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof tv);
+   return fd;
+}
+
+/* ************************************ */
+/* **************RPC LAYER************* */
+/* ************************************ */
+
+static bool is_request(uint8_t control_flags)
+{
+   if ((control_flags & MSG_CONTROL_FLAG_REQUEST) != 0)
+   {
+      return true;
+   }
+   return false;
+}
+
+static bool is_reply(uint8_t control_flags)
+{
+   if ((control_flags & MSG_CONTROL_FLAG_REPLY) != 0)
+   {
+      return true;
+   }
+   return false;
+}
+
+static uint32_t new_sequence_number(EDGEDATA_IPC_FD* fd)
+{
+   /* read by the keep alive timer of the receive loop */
+   return __atomic_add_fetch(&fd->sequence, 1, __ATOMIC_RELAXED);
+}
+
+/* larger payloads than one frame are only sent to peers which reassemble them */
+uint32_t edgedata_rpc_max_payload_len(EDGEDATA_IPC_FD* fd)
+{
+   if ((fd != NULL) && ((fd->peer_capabilities & CAPABILITY_FRAGMENTATION) != 0))
+   {
+      return MSG_MAX_LARGE_PAYLOAD_SIZE;
+   }
+   return MAX_PAYLOAD_SIZE;
+}
+
+/* ************ CREDITS *************** */
+/* A peer with CAPABILITY_CREDITS accepts msg_credits outstanding requests, further requests wait */
+/* (edgedata_rpc_credit_wait) or are refused (edgedata_rpc_credit_try) until replies return credit. */
+
+/* caller holds pending_requests_mutex, a list larger than the credit is accepted if nothing is outstanding */
+static bool edgedata_rpc_credit_available(EDGEDATA_IPC_FD* fd, uint32_t count)
+{
+   uint32_t outstanding = (uint32_t)fd->pending_requests.size();
+   if ((fd->peer_capabilities & CAPABILITY_CREDITS) == 0)
+   {
+      return true;
+   }
+   return ((outstanding == 0) || ((outstanding + count) <= fd->peer_credits));
+}
+
+/* caller holds pending_requests_mutex: wakes waiting senders, true if credit_cb has to be called (once half of the credit is free) */
+static bool edgedata_rpc_credit_returned(EDGEDATA_IPC_FD* fd)
+{
+   pthread_cond_broadcast(&fd->window_cond);
+   if ((fd->b_credit_wanted) && (fd->pending_requests.size() <= (fd->peer_credits / 2)))
+   {
+      fd->b_credit_wanted = false;
+      return (fd->credit_cb != NULL);
+   }
+   return false;
+}
+
+/* outside of pending_requests_mutex, after edgedata_rpc_credit_returned returned true. The callback runs on the receive */
+/* thread (or in edge_data_process), an application thread may hold ACCESS_APP or a send lane and only records it.     */
+static void edgedata_rpc_credit_notify(EDGEDATA_IPC_FD* fd)
+{
+   bool b_receiver;
+   if (fd->b_recv_thread)
+   {
+      b_receiver = (pthread_equal(pthread_self(), fd->p_thread_recv) != 0);
+   }
+   else
+   {
+      b_receiver = ((fd->b_recv_busy) && (!fd->b_defer_callbacks));
+   }
+   if (!b_receiver)
+   {  /* see edgedata_rpc_run_deferred_callbacks */
+      fd->b_credit_cb_deferred = true;
+      if ((fd->b_recv_thread) && (fd->shutdown_event_fd >= 0))
+      {
+         uint64_t counter = 1;
+         (void)write(fd->shutdown_event_fd, &counter, sizeof(counter));
+      }
+      return;
+   }
+   fd->credit_cb((void*)fd);
+}
+
+static void edgedata_rpc_credit_update(EDGEDATA_IPC_FD* fd, uint32_t credits)
+{
+   bool b_credit_cb;
+   ENTER_PENDING_REQUESTS(fd);
+   fd->peer_credits = credits;
+   b_credit_cb = edgedata_rpc_credit_returned(fd);
+   LEAVE_PENDING_REQUESTS(fd);
+   if (b_credit_cb)
+   {
+      edgedata_rpc_credit_notify(fd);
+   }
+}
+
+/* receive thread, first message of a receive batch: msg_credits are the full frames the receive ring or buffer */
+/* still takes (the backlog the batch starts with), at least 1 and at most RPC_CREDITS                           */
+static void edgedata_rpc_credits_refresh(EDGEDATA_IPC_FD* fd)
+{
+   uint32_t free_len;
+   uint32_t credits;
+   if ((fd->peer_capabilities & CAPABILITY_CREDITS) == 0)
+   {
+      return;
+   }
+   if (fd->shm != NULL)
+   {
+      EDGEDATA_SHM_RING* ring = fd->shm->recv_ring;
+      free_len = SHM_RING_SIZE - (ring->head.load(std::memory_order_acquire) - ring->tail.load(std::memory_order_relaxed));
+   }
+   else
+   {  /* a seqpacket read takes one message, the buffer is free again */
+      free_len = RECV_BUFFER_SIZE - (fd->recv_buffer_end - fd->recv_buffer_start);
+   }
+   credits = free_len / MSG_MAX_FULL_SIZE;
+   if (credits > RPC_CREDITS)
+   {
+      credits = RPC_CREDITS;
+   }
+   __atomic_store_n(&fd->recv_credits, (uint16_t)((credits > 0) ? credits : 1), __ATOMIC_RELAXED);
+}
+
+static bool set_package_info(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t reply_sequence, uint8_t control_flags, unsigned char* p_msg_payload, uint32_t msg_payload_len)
+{
+   EDGEDATA_RPC_HEADER* header;
+   if ((fd == NULL) || (p_msg_payload == NULL) || (msg_payload_len > edgedata_rpc_max_payload_len(fd)))
+   {
+      return false;
+   }
+   header = (EDGEDATA_RPC_HEADER*)&fd->send_header;
+   memset(header, 0, sizeof(EDGEDATA_RPC_HEADER));
+   /* set header */
+   header->msg_type = message_type;
+   header->msg_payload_len = msg_payload_len;
+   header->msg_control_flags = control_flags;
+   if ((fd->peer_capabilities & CAPABILITY_CREDITS) != 0)
+   {
+      header->msg_credits = __atomic_load_n(&fd->recv_credits, __ATOMIC_RELAXED);
+   }
+
+   if (is_reply(control_flags))
+   {  /* use sequence from response */
+      header->msg_sequence = reply_sequence;
+   }
+   else
+   {  /* create new sequence number */
+      header->msg_sequence = new_sequence_number(fd);
+   }
+   /* payload stays in the caller buffer until edgedata_ipc_write */
+   return true;
+}
+
+static bool get_package_info(EDGEDATA_IPC_FD* fd, uint32_t* p_message_type, uint32_t* p_sequence, uint8_t* p_msg_control_flags, unsigned char** p_payload, uint32_t* p_payload_len)
+{
+   EDGEDATA_RPC_HEADER* header;
+
+   if ((fd == NULL) || (p_message_type == NULL) || (p_sequence == NULL) || (p_msg_control_flags == NULL) || (p_payload == NULL) || (p_payload_len == NULL))
+   {
+      return false;
+   }
+   header = (EDGEDATA_RPC_HEADER*)&fd->p_recv_message->header;
+   *p_message_type = header->msg_type;
+   *p_sequence = header->msg_sequence;
+   *p_payload_len = header->msg_payload_len;
+   *p_msg_control_flags = header->msg_control_flags;
+   *p_payload = fd->p_recv_message->payload;
+   if (((fd->peer_capabilities & CAPABILITY_CREDITS) != 0) && (header->msg_credits != fd->peer_credits))
+   {  /* peer_credits is only written by the receive thread */
+      edgedata_rpc_credit_update(fd, header->msg_credits);
+   }
+   return true;
+}
+
+/* registered before the request is written, the reply may arrive before the write returns */
+static bool edgedata_rpc_pending_add(EDGEDATA_IPC_FD* fd, EDGEDATA_RPC_PENDING* pending, uint32_t sequence)
+{
+   bool ret = false;
+   pending->sequence = sequence;
+   pending->b_done = false;
+   pending->b_error = false;
+   pending->b_timeout = false;
+   ENTER_PENDING_REQUESTS(fd);
+   if (!fd->b_pending_requests_closed)
+   {
+      pthread_condattr_t attr;
+      pthread_condattr_init(&attr);
+      pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+      pthread_cond_init(&pending->cond, &attr);
+      pthread_condattr_destroy(&attr);
+      fd->pending_requests[sequence] = pending;
+      ret = true;
+   }
+   LEAVE_PENDING_REQUESTS(fd);
+   return ret;
+}
+
+static void edgedata_rpc_pending_remove(EDGEDATA_IPC_FD* fd, EDGEDATA_RPC_PENDING* pending)
+{
+   bool b_credit_cb;
+   ENTER_PENDING_REQUESTS(fd);
+   (void)fd->pending_requests.erase(pending->sequence);
+   b_credit_cb = edgedata_rpc_credit_returned(fd);
+   LEAVE_PENDING_REQUESTS(fd);
+   pthread_cond_destroy(&pending->cond);
+   if (b_credit_cb)
+   {
+      edgedata_rpc_credit_notify(fd);
+   }
+}
+
+/* asynchronous request: the callback runs outside of pending_requests_mutex, then the entry is freed */
+static void edgedata_rpc_pending_complete_async(EDGEDATA_IPC_FD* fd, EDGEDATA_RPC_PENDING* pending)
+{
+   if (fd->b_defer_callbacks)
+   {  /* see edgedata_rpc_run_deferred_callbacks */
+      EDGEDATA_DEFERRED_CALLBACK deferred;
+      deferred.event_cb = NULL;
+      deferred.pending = pending;
+      fd->deferred_callbacks.push_back(deferred);
+      return;
+   }
+   pending->cb((void*)fd, pending->context, !pending->b_error);
+   pthread_cond_destroy(&pending->cond);
+   delete pending;
+}
+
+/* CLOCK_MONOTONIC deadline for pthread_cond_timedwait */
+static void edgedata_rpc_deadline(struct timespec* deadline, uint32_t timeout_ms)
+{
+   clock_gettime(CLOCK_MONOTONIC, deadline);
+   deadline->tv_sec += timeout_ms / 1000;
+   deadline->tv_nsec += (timeout_ms % 1000) * 1000000;
+   if (deadline->tv_nsec >= 1000000000)
+   {
+      deadline->tv_sec++;
+      deadline->tv_nsec -= 1000000000;
+   }
+}
+
+/* caller holds pending_requests_mutex: waits for a signal of the receive thread, */
+/* without receive thread the caller receives itself until the deadline          */
+static int32_t edgedata_rpc_wait_signal(EDGEDATA_IPC_FD* fd, pthread_cond_t* cond, struct timespec* deadline)
+{
+   struct timespec now;
+   int64_t remaining_ms;
+   if (!fd->b_recv_by_caller)
+   {
+      return pthread_cond_timedwait(cond, &fd->pending_requests_mutex, deadline);
+   }
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   remaining_ms = ((((int64_t)(deadline->tv_sec - now.tv_sec) * 1000000000) + (deadline->tv_nsec - now.tv_nsec)) + 999999) / 1000000;
+   if ((remaining_ms <= 0) || (fd->b_recv_busy))
+   {  /* b_recv_busy: waiting inside a callback, a nested receive would overwrite the message being dispatched */
+      return ETIMEDOUT;
+   }
+   LEAVE_PENDING_REQUESTS(fd);
+   /* one round (the caller checks its condition again), on connection loss the requests are failed already. */
+   /* The caller holds ACCESS_APP: application callbacks run after the API call released it.                 */
+   fd->b_defer_callbacks = true;
+   (void)edgedata_thread_recv_process(fd, (remaining_ms < 1000) ? (int32_t)remaining_ms : 1000);
+   fd->b_defer_callbacks = false;
+   ENTER_PENDING_REQUESTS(fd);
+   return 0;
+}
+
+static bool wait_for_response(EDGEDATA_IPC_FD* fd, EDGEDATA_RPC_PENDING* pending, uint32_t timeout_ms)
+{
+   bool ret;
+   bool b_credit_cb = false;
+   struct timespec deadline;
+   edgedata_rpc_deadline(&deadline, timeout_ms);
+   ENTER_PENDING_REQUESTS(fd);
+   while (!pending->b_done)
+   {
+      if ((edgedata_rpc_wait_signal(fd, &pending->cond, &deadline) == ETIMEDOUT) && (!pending->b_done))
+      {  /* a late reply finds no entry and is dropped, the connection stays open (the credit is returned) */
+         (void)fd->pending_requests.erase(pending->sequence);
+         pending->b_done = true;
+         pending->b_error = true;
+         pending->b_timeout = true;
+         fd->statistics.request_timeouts++;
+         b_credit_cb = edgedata_rpc_credit_returned(fd);
+      }
+   }
+   ret = !pending->b_error;
+   LEAVE_PENDING_REQUESTS(fd);
+   pthread_cond_destroy(&pending->cond);
+   if (b_credit_cb)
+   {
+      edgedata_rpc_credit_notify(fd);
+   }
+   return ret;
+}
+
+static void edgedata_rpc_inform_about_response(EDGEDATA_IPC_FD* fd, uint32_t sequence)
+{
+   EDGEDATA_RPC_PENDING* async_pending = NULL;
+   bool b_credit_cb = false;
+   ENTER_PENDING_REQUESTS(fd);
+   std::map<uint32_t, EDGEDATA_RPC_PENDING*>::iterator it = fd->pending_requests.find(sequence);
+   if (it != fd->pending_requests.end())
+   {
+      it->second->b_done = true;
+      if (it->second->cb != NULL)
+      {
+         async_pending = it->second;
+      }
+      else
+      {
+         pthread_cond_signal(&it->second->cond);
+      }
+      fd->pending_requests.erase(it);
+      b_credit_cb = edgedata_rpc_credit_returned(fd);
+   }
+   LEAVE_PENDING_REQUESTS(fd);
+   if (async_pending != NULL)
+   {
+      edgedata_rpc_pending_complete_async(fd, async_pending);
+   }
+   if (b_credit_cb)
+   {
+      edgedata_rpc_credit_notify(fd);
+   }
+}
+
+/* connection lost: fail all outstanding requests and every later one */
+void edgedata_rpc_unlock_pending_requests(EDGEDATA_IPC_FD* fd)
+{
+   std::vector<EDGEDATA_RPC_PENDING*> async_pending;
+   bool b_credit_cb;
+   ENTER_PENDING_REQUESTS(fd);
+   fd->b_pending_requests_closed = true;
+   for (std::map<uint32_t, EDGEDATA_RPC_PENDING*>::iterator it = fd->pending_requests.begin(); it != fd->pending_requests.end(); it++)
+   {
+      it->second->b_error = true;
+      it->second->b_done = true;
+      if (it->second->cb != NULL)
+      {
+         async_pending.push_back(it->second);
+      }
+      else
+      {
+         pthread_cond_signal(&it->second->cond);
+      }
+   }
+   fd->pending_requests.clear();
+   /* wakes senders waiting for credit or the stream window, an application waiting for the credit callback retries and fails */
+   b_credit_cb = edgedata_rpc_credit_returned(fd);
+   LEAVE_PENDING_REQUESTS(fd);
+   for (uint32_t i = 0; i < async_pending.size(); i++)
+   {
+      edgedata_rpc_pending_complete_async(fd, async_pending[i]);
+   }
+   if (b_credit_cb)
+   {
+      edgedata_rpc_credit_notify(fd);
+   }
+}
+
+/* application callbacks deferred by a receive inside an API call (process by caller) and a credit callback deferred by */
+/* an application thread, called by the receive thread or an API call which does not hold ACCESS_APP                    */
+void edgedata_rpc_run_deferred_callbacks(EDGEDATA_IPC_FD* fd)
+{
+   std::vector<EDGEDATA_DEFERRED_CALLBACK> callbacks;
+   while ((!fd->deferred_callbacks.empty()) || (fd->b_credit_cb_deferred))
+   {  /* a callback may defer further ones (e.g. by edge_data_sync_write) */
+      callbacks.swap(fd->deferred_callbacks);
+      for (uint32_t i = 0; i < callbacks.size(); i++)
+      {
+         if (callbacks[i].event_cb != NULL)
+         {
+            callbacks[i].event_cb(&callbacks[i].event);
+         }
+         else
+         {
+            edgedata_rpc_pending_complete_async(fd, callbacks[i].pending);
+         }
+      }
+      callbacks.clear();
+      if (fd->b_credit_cb_deferred.exchange(false))
+      {
+         fd->credit_cb((void*)fd);
+      }
+   }
+}
+
+/* writes one message, payloads larger than one frame go out as fragments with the same type and sequence */
+static bool edgedata_rpc_write(EDGEDATA_IPC_FD* fd, unsigned char* payload)
+{
+   uint32_t payload_len = fd->send_header.msg_payload_len;
+   uint8_t control_flags = fd->send_header.msg_control_flags;
+   uint32_t offset = 0;
+   bool ret = true;
+
+   if (payload_len <= MAX_PAYLOAD_SIZE)
+   {
+      return edgedata_ipc_write(fd, payload);
+   }
+   while ((ret) && (offset < payload_len))
+   {
+      uint32_t fragment_len = payload_len - offset;
+      if (fragment_len > MAX_PAYLOAD_SIZE)
+      {
+         fragment_len = MAX_PAYLOAD_SIZE;
+      }
+      fd->send_header.msg_payload_len = fragment_len;
+      fd->send_header.msg_control_flags = ((offset + fragment_len) < payload_len) ? (control_flags | MSG_CONTROL_FLAG_FRAGMENT) : control_flags;
+      ret = edgedata_ipc_write(fd, &payload[offset]);
+      offset += fragment_len;
+   }
+   fd->send_header.msg_payload_len = payload_len;
+   fd->send_header.msg_control_flags = control_flags;
+   return ret;
+}
+
+/* ************ SEND LANES ************ */
+/* Data updates wait while control messages are waiting for the critical section, */
+/* e.g. a ping or a reply overtakes a burst of events sent by other threads.      */
+
+static uint32_t edgedata_rpc_lane(uint32_t message_type, uint8_t control_flags)
+{
+   if ((message_type == MSG_TYPE_UPDATE_DATA) && (!is_reply(control_flags)))
+   {
+      return RPC_LANE_BULK;
+   }
+   return RPC_LANE_CONTROL;
+}
+
+static void edgedata_rpc_lane_enter(EDGEDATA_IPC_FD* fd, uint32_t lane)
+{
+   pthread_mutex_lock(&fd->send_lanes_mutex);
+   if ((fd->b_lane_sending) || (fd->lane_waiting[RPC_LANE_CONTROL] != 0))
+   {
+      uint64_t* p_depth = (lane == RPC_LANE_CONTROL) ? &fd->statistics.send_queue_control : &fd->statistics.send_queue_bulk;
+      uint64_t* p_depth_max = (lane == RPC_LANE_CONTROL) ? &fd->statistics.send_queue_control_max : &fd->statistics.send_queue_bulk_max;
+      fd->lane_waiting[lane]++;
+      *p_depth = fd->lane_waiting[lane];
+      if (*p_depth > *p_depth_max)
+      {
+         *p_depth_max = *p_depth;
+      }
+      while ((fd->b_lane_sending) || ((lane == RPC_LANE_BULK) && (fd->lane_waiting[RPC_LANE_CONTROL] != 0)))
+      {
+         pthread_cond_wait(&fd->send_lanes_cond, &fd->send_lanes_mutex);
+      }
+      fd->lane_waiting[lane]--;
+      *p_depth = fd->lane_waiting[lane];
+   }
+   fd->b_lane_sending = true;
+   pthread_mutex_unlock(&fd->send_lanes_mutex);
+}
+
+static void edgedata_rpc_lane_leave(EDGEDATA_IPC_FD* fd)
+{
+   pthread_mutex_lock(&fd->send_lanes_mutex);
+   fd->b_lane_sending = false;
+   if ((fd->lane_waiting[RPC_LANE_CONTROL] != 0) || (fd->lane_waiting[RPC_LANE_BULK] != 0))
+   {
+      pthread_cond_broadcast(&fd->send_lanes_cond);
+   }
+   pthread_mutex_unlock(&fd->send_lanes_mutex);
+}
+
+/* writes the message, a request is registered in pending and stays outstanding until wait_for_response */
+static bool edgedata_rpc_send_begin(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t reply_sequence, uint8_t control_flags, unsigned char* payload, uint32_t payload_len, EDGEDATA_RPC_PENDING* pending)
+{
+   bool ret = false;
+   uint32_t lane;
+   if ((fd == NULL) || (payload == NULL) || ((is_request(control_flags)) && (pending == NULL)))
+   {
+      return false;
+   }
+
+   lane = edgedata_rpc_lane(message_type, control_flags);
+   edgedata_rpc_lane_enter(fd, lane);
+   ENTER_CRITICAL_SECTION(fd);
+   if ((fd->b_connected) && (fd->write_fd != 0) && (fd->read_fd != 0))
+   {
+      /* setup header */
+      if ((set_package_info(fd, message_type, reply_sequence, control_flags, payload, payload_len)) &&
+         ((!is_request(control_flags)) || (edgedata_rpc_pending_add(fd, pending, fd->send_header.msg_sequence))))
+      {
+         DEBUG_RPC_LOG("try to write\n");
+         if (edgedata_rpc_write(fd, payload))
+         {
+            DEBUG_RPC_LOG("write finished (Payload: %d)\n", fd->send_header.msg_payload_len);
+            if ((fd->shm_pending != NULL) && (is_reply(control_flags)))
+            {  /* shared memory setup reply went out on the unix socket, everything after uses the rings */
+               if (fd->send_queue_start != fd->send_queue.size())
+               {  /* queued bytes must not follow on the rings */
+                  ERROR_LOG("Shared memory setup reply not sent\n");
+                  fd->b_send_failed = true;
+                  edgedata_ipc_shm_free(&fd->shm_pending);
+               }
+               else
+               {
+                  edgedata_ipc_shm_activate(fd, fd->shm_pending);
+               }
+               fd->shm_pending = NULL;
+            }
+            ret = true;
+         }
+         else
+         {
+            ERROR_LOG("Error write message\n");
+            if (is_request(control_flags))
+            {
+               edgedata_rpc_pending_remove(fd, pending);
+            }
+         }
+      }
+      else
+      {
+         ERROR_LOG("RPC send failed (connection already closed)");
+      }
+   }
+   LEAVE_CRITICAL_SECTION(fd);
+   edgedata_rpc_lane_leave(fd);
+   return ret;
+}
+
+static bool edgedata_rpc_send(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t reply_sequence, uint8_t control_flags, unsigned char* payload, uint32_t payload_len)
+{
+   EDGEDATA_RPC_PENDING pending;
+   pending.cb = NULL;
+   if (!edgedata_rpc_send_begin(fd, message_type, reply_sequence, control_flags, payload, payload_len, &pending))
+   {
+      return false;
+   }
+   if (is_request(control_flags))
+   {  /* its a request, other requests may be sent while waiting */
+      DEBUG_LOCK_LOG("Wait for reponse (messagetype: %d)\n", message_type);
+      return wait_for_response(fd, &pending, RPC_REPLY_TIMEOUT_MS);
+   }
+   /* e.g. fire and forget or reply */
+   return true;
+}
+
+bool edgedata_rpc_send_fire_and_forget(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len)
+{
+   return edgedata_rpc_send(fd, message_type, 0, 0, payload, payload_len);
+}
+bool edgedata_rpc_send_request(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len)
+{
+   return edgedata_rpc_send(fd, message_type, 0, MSG_CONTROL_FLAG_REQUEST, payload, payload_len);
+}
+bool edgedata_rpc_send_reply(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t reply_sequence, unsigned char* payload, uint32_t payload_len)
+{
+   return edgedata_rpc_send(fd, message_type, reply_sequence, MSG_CONTROL_FLAG_REPLY, payload, payload_len);
+}
+/* pipelining: every request sent successfully has to be completed with edgedata_rpc_wait_for_reply */
+bool edgedata_rpc_send_request_begin(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len, EDGEDATA_RPC_PENDING* pending)
+{
+   if (pending == NULL)
+   {
+      return false;
+   }
+   pending->cb = NULL;
+   return edgedata_rpc_send_begin(fd, message_type, 0, MSG_CONTROL_FLAG_REQUEST, payload, payload_len, pending);
+}
+bool edgedata_rpc_wait_for_reply(EDGEDATA_IPC_FD* fd, EDGEDATA_RPC_PENDING* pending, uint32_t timeout_ms)
+{
+   return wait_for_response(fd, pending, timeout_ms);
+}
+/* returns without waiting, cb is called by the receive thread with the reply or on connection loss (not if false is returned) */
+bool edgedata_rpc_send_request_async(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len, fct_rpc_completion cb, void* context)
+{
+   EDGEDATA_RPC_PENDING* pending;
+   if (cb == NULL)
+   {
+      return false;
+   }
+   pending = new EDGEDATA_RPC_PENDING();
+   pending->cb = cb;
+   pending->context = context;
+   if (!edgedata_rpc_send_begin(fd, message_type, 0, MSG_CONTROL_FLAG_REQUEST, payload, payload_len, pending))
+   {
+      delete pending;
+      return false;
+   }
+   return true;
+}
+
+/* waits until the peer accepts one more request, false on timeout or connection loss */
+bool edgedata_rpc_credit_wait(EDGEDATA_IPC_FD* fd, uint32_t timeout_ms)
+{
+   bool ret = true;
+   bool b_stalled = false;
+   struct timespec deadline;
+   edgedata_rpc_deadline(&deadline, timeout_ms);
+   ENTER_PENDING_REQUESTS(fd);
+   while ((ret) && (!fd->b_pending_requests_closed) && (!edgedata_rpc_credit_available(fd, 1)))
+   {
+      b_stalled = true;
+      if (edgedata_rpc_wait_signal(fd, &fd->window_cond, &deadline) == ETIMEDOUT)
+      {
+         ret = false;
+      }
+   }
+   if (b_stalled)
+   {
+      fd->statistics.credit_stalls++;
+   }
+   if (fd->b_pending_requests_closed)
+   {
+      ret = false;
+   }
+   LEAVE_PENDING_REQUESTS(fd);
+   return ret;
+}
+
+/* does not wait: false if the peer does not accept count more requests, fd->credit_cb follows once credit returned */
+bool edgedata_rpc_credit_try(EDGEDATA_IPC_FD* fd, uint32_t count)
+{
+   bool ret;
+   ENTER_PENDING_REQUESTS(fd);
+   ret = edgedata_rpc_credit_available(fd, count);
+   if (!ret)
+   {
+      fd->b_credit_wanted = true;
+      fd->statistics.credit_stalls++;
+   }
+   LEAVE_PENDING_REQUESTS(fd);
+   return ret;
+}
+
+/* ********** EVENT STREAM ************ */
+/* Events to a peer with CAPABILITY_EVENT_STREAM are sent without reply. The peer counts them */
+/* and returns the count with MSG_TYPE_EVENT_ACK, at most EVENT_STREAM_WINDOW are unacknowledged. */
+
+static bool edgedata_rpc_stream_supported(EDGEDATA_IPC_FD* fd)
+{
+   return ((fd->peer_capabilities & CAPABILITY_EVENT_STREAM) != 0);
+}
+
+/* waits until the window has room for one more event, a server connection does not wait (its send queue is bounded) */
+static bool edgedata_rpc_stream_reserve(EDGEDATA_IPC_FD* fd)
+{
+   bool ret = true;
+   struct timespec deadline;
+   edgedata_rpc_deadline(&deadline, RPC_REPLY_TIMEOUT_MS);
+   ENTER_PENDING_REQUESTS(fd);
+   while ((ret) && (!fd->b_send_queue) && (!fd->b_pending_requests_closed) && ((fd->stream_sent - fd->stream_acked) >= EVENT_STREAM_WINDOW))
+   {
+      if (edgedata_rpc_wait_signal(fd, &fd->window_cond, &deadline) == ETIMEDOUT)
+      {
+         fd->statistics.request_timeouts++;
+         ret = false;
+      }
+   }
+   if (fd->b_pending_requests_closed)
+   {
+      ret = false;
+   }
+   if (ret)
+   {
+      fd->stream_sent++;
+   }
+   LEAVE_PENDING_REQUESTS(fd);
+   return ret;
+}
+
+/* sender: ack holds the number of events the peer received (counts may wrap) */
+static void edgedata_rpc_stream_acked(void* fd, unsigned char* payload, uint32_t payload_len)
+{
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   uint32_t ack;
+   if (payload_len != sizeof(ack))
+   {
+      return;
+   }
+   memcpy(&ack, payload, sizeof(ack));
+   ENTER_PENDING_REQUESTS(m_fd);
+   if (((int32_t)(ack - m_fd->stream_acked) > 0) && ((int32_t)(m_fd->stream_sent - ack) >= 0))
+   {
+      m_fd->stream_acked = ack;
+      pthread_cond_broadcast(&m_fd->window_cond);
+   }
+   LEAVE_PENDING_REQUESTS(m_fd);
+}
+
+/* receive thread: stream_ack_timer_fd expires in timeout_ms (at least 1 ms), it stays armed until it expired */
+static void edgedata_rpc_stream_ack_arm(EDGEDATA_IPC_FD* fd, int64_t timeout_ms)
+{
+   struct itimerspec deadline;
+   timeout_ms = (timeout_ms > 0) ? timeout_ms : 1;
+   deadline.it_interval.tv_sec = 0;
+   deadline.it_interval.tv_nsec = 0;
+   deadline.it_value.tv_sec = timeout_ms / 1000;
+   deadline.it_value.tv_nsec = (timeout_ms % 1000) * 1000000;
+   fd->b_stream_ack_armed = (timerfd_settime(fd->stream_ack_timer_fd, 0, &deadline, NULL) == 0);
+}
+
+/* receiver: counts a received event (b_received) and acknowledges every EVENT_STREAM_ACK_MESSAGES events or     */
+/* EVENT_STREAM_ACK_MS after the oldest unacknowledged one. The first unacknowledged event arms stream_ack_timer_fd, */
+/* the server loop uses the returned time (when the events not acknowledged yet are due, 0 -> none) as timeout.      */
+int64_t edgedata_rpc_stream_ack(EDGEDATA_IPC_FD* fd, bool b_received)
+{
+   uint32_t ack = 0;
+   bool b_send = false;
+   bool b_first = false;
+   int64_t due_ms = 0;
+   int64_t now = edgedata_time_ms();
+   ENTER_PENDING_REQUESTS(fd);
+   if (b_received)
+   {
+      if (fd->stream_received == fd->stream_ack_sent)
+      {
+         fd->stream_unacked_ms = now;
+         b_first = true;
+      }
+      fd->stream_received++;
+   }
+   uint32_t unacked = fd->stream_received - fd->stream_ack_sent;
+   if ((unacked >= EVENT_STREAM_ACK_MESSAGES) || ((unacked > 0) && ((now - fd->stream_unacked_ms) >= EVENT_STREAM_ACK_MS)))
+   {
+      fd->stream_ack_sent = fd->stream_received;
+      ack = fd->stream_received;
+      b_send = true;
+   }
+   else if (unacked > 0)
+   {
+      due_ms = fd->stream_unacked_ms + EVENT_STREAM_ACK_MS;
+   }
+   LEAVE_PENDING_REQUESTS(fd);
+   if (b_send)
+   {  /* outside of pending_requests_mutex, an ack overtaken by a newer one is ignored by the sender */
+      (void)edgedata_rpc_send_fire_and_forget(fd, MSG_TYPE_EVENT_ACK, (unsigned char*)&ack, sizeof(ack));
+   }
+   else if ((b_first) && (fd->stream_ack_timer_fd >= 0) && (!fd->b_stream_ack_armed))
+   {  /* a burst may end before EVENT_STREAM_ACK_MESSAGES, keep alive would ack it up to a second later */
+      edgedata_rpc_stream_ack_arm(fd, EVENT_STREAM_ACK_MS);
+   }
+   return due_ms;
+}
+
+/* event without round trip, older peers get a request and the reply is waited for */
+bool edgedata_rpc_send_stream(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len)
+{
+   if (fd == NULL)
+   {
+      return false;
+   }
+   if (!edgedata_rpc_stream_supported(fd))
+   {
+      return edgedata_rpc_send_request(fd, message_type, payload, payload_len);
+   }
+   if (!edgedata_rpc_stream_reserve(fd))
+   {
+      return false;
+   }
+   return edgedata_rpc_send(fd, message_type, 0, MSG_CONTROL_FLAG_STREAM, payload, payload_len);
+}
+
+/* ********** SHM SETUP *************** */
+
+/* Client side: offer shared memory rings to the server (before the threads are started) */
+bool edgedata_ipc_shm_client_setup(EDGEDATA_IPC_FD* fd)
+{
+   EDGEDATA_SHM_SETUP setup;
+   EDGEDATA_SHM_TRANSPORT* shm;
+   int32_t fds[SHM_SETUP_FDS];
+   struct msghdr msg;
+   struct iovec iov[2];
+   union {
+      struct cmsghdr align;
+      char buff[CMSG_SPACE(sizeof(fds))];
+   } control;
+   uint32_t message_type;
+   uint32_t sequence;
+   uint32_t payload_len;
+   uint8_t  control_flags;
+   unsigned char* payload;
+
+   fds[0] = memfd_create("edgedata", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+   fds[1] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);   /* data client to server */
+   fds[2] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);   /* data server to client */
+   fds[3] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);   /* space client to server */
+   fds[4] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);   /* space server to client */
+   /* sealed size: the server maps it and must not get SIGBUS by a later ftruncate */
+   if ((fds[0] < 0) || (fds[1] < 0) || (fds[2] < 0) || (fds[3] < 0) || (fds[4] < 0) || (ftruncate(fds[0], sizeof(EDGEDATA_SHM_AREA)) != 0) ||
+      (fcntl(fds[0], F_ADD_SEALS, SHM_SEALS) != 0))
+   {
+      ERROR_LOG("Error create shared memory\n");
+      for (uint32_t i = 0; i < SHM_SETUP_FDS; i++)
+      {
+         if (fds[i] >= 0)
+         {
+            close(fds[i]);
+         }
+      }
+      return false;
+   }
+   shm = edgedata_ipc_shm_map(fds, false);
+   if (shm == NULL)
+   {
+      return false;
+   }
+   shm->area->magic = SHM_MAGIC;
+   shm->area->ring_size = SHM_RING_SIZE;
+
+   setup.magic = SHM_MAGIC;
+   setup.ring_size = SHM_RING_SIZE;
+   if (!set_package_info(fd, MSG_TYPE_SHM_SETUP, 0, MSG_CONTROL_FLAG_REQUEST, (unsigned char*)&setup, sizeof(setup)))
+   {
+      edgedata_ipc_shm_free(&shm);
+      return false;
+   }
+
+   /* request and file descriptors in one message */
+   memset(&msg, 0, sizeof(msg));
+   memset(&control, 0, sizeof(control));
+   iov[0].iov_base = (void*)&fd->send_header;
+   iov[0].iov_len = sizeof(fd->send_header);
+   iov[1].iov_base = (void*)&setup;
+   iov[1].iov_len = sizeof(setup);
+   msg.msg_iov = iov;
+   msg.msg_iovlen = 2;
+   msg.msg_control = control.buff;
+   msg.msg_controllen = sizeof(control.buff);
+   struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+   cmsg->cmsg_level = SOL_SOCKET;
+   cmsg->cmsg_type = SCM_RIGHTS;
+   cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+   memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+   if (sendmsg(fd->write_fd, &msg, 0) != (ssize_t)(sizeof(fd->send_header) + sizeof(setup)))
+   {
+      ERROR_LOG("Error send shared memory setup\n");
+      edgedata_ipc_shm_free(&shm);
+      return false;
+   }
+
+   /* an older server answers with an empty reply -> stay on unix socket */
+   if ((!edgedata_rpc_recv(fd, &message_type, &sequence, &control_flags, &payload, &payload_len)) ||
+      (message_type != MSG_TYPE_SHM_SETUP) || (!is_reply(control_flags)) || (sequence != fd->send_header.msg_sequence) ||
+      (payload_len != sizeof(setup)) || (memcmp(payload, &setup, sizeof(setup)) != 0))
+   {
+      edgedata_ipc_shm_free(&shm);
+      return false;
+   }
+   edgedata_ipc_shm_activate(fd, shm);
+   return true;
+}
+
+/* Server side: map the offered rings, switch over as soon as the reply is sent */
+uint32_t edgedata_ipc_shm_setup_with_reply(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len)
+{
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   EDGEDATA_SHM_SETUP setup;
+   EDGEDATA_SHM_TRANSPORT* shm = NULL;
+   struct stat st;
+   uint32_t received_fds_len = m_fd->received_fds_len;
+
+   m_fd->received_fds_len = 0;
+   if (payload_len == sizeof(setup))
+   {
+      memcpy(&setup, payload, sizeof(setup));
+   }
+   if ((received_fds_len != SHM_SETUP_FDS) || (payload_len != sizeof(setup)) || (setup.magic != SHM_MAGIC) || (setup.ring_size != SHM_RING_SIZE) ||
+      (max_payload_reply_len < sizeof(setup)) || (m_fd->shm != NULL) || (m_fd->shm_pending != NULL) ||
+      (fstat(m_fd->received_fds[0], &st) != 0) || (st.st_size < (off_t)sizeof(EDGEDATA_SHM_AREA)) ||
+      ((fcntl(m_fd->received_fds[0], F_GET_SEALS) & SHM_SEALS) != SHM_SEALS))
+   {
+      ERROR_LOG("Invalid shared memory setup\n");
+      for (uint32_t i = 0; i < received_fds_len; i++)
+      {
+         close(m_fd->received_fds[i]);
+      }
+      return 0;
+   }
+   shm = edgedata_ipc_shm_map(m_fd->received_fds, true);
+   if ((shm == NULL) || (shm->area->magic != SHM_MAGIC) || (shm->area->ring_size != SHM_RING_SIZE))
+   {
+      ERROR_LOG("Invalid shared memory area\n");
+      edgedata_ipc_shm_free(&shm);
+      return 0;
+   }
+   m_fd->shm_pending = shm;
+   memcpy(payload_reply, &setup, sizeof(setup));
+   return sizeof(setup);
+}
+
+/* ******** CAPABILITIES ************** */
+
+/* Client side: exchange capabilities (before the threads are started), an older server answers with an empty reply */
+bool edgedata_rpc_capabilities_client_exchange(EDGEDATA_IPC_FD* fd)
+{
+   uint32_t capabilities = EDGEDATA_CAPABILITIES;
+   uint32_t message_type;
+   uint32_t sequence;
+   uint32_t payload_len;
+   uint8_t  control_flags;
+   unsigned char* payload;
+
+   if ((!set_package_info(fd, MSG_TYPE_CAPABILITIES, 0, MSG_CONTROL_FLAG_REQUEST, (unsigned char*)&capabilities, sizeof(capabilities))) ||
+      (!edgedata_ipc_write(fd, (unsigned char*)&capabilities)))
+   {
+      return false;
+   }
+   if ((!edgedata_rpc_recv(fd, &message_type, &sequence, &control_flags, &payload, &payload_len)) ||
+      (message_type != MSG_TYPE_CAPABILITIES) || (!is_reply(control_flags)) || (sequence != fd->send_header.msg_sequence))
+   {
+      return false;
+   }
+   if (payload_len == sizeof(capabilities))
+   {
+      memcpy(&capabilities, payload, sizeof(capabilities));
+      fd->peer_capabilities = capabilities & EDGEDATA_CAPABILITIES;
+      fd->peer_credits = fd->p_recv_message->header.msg_credits;
+   }
+   return true;
+}
+
+/* Server side: remember what the client supports, answer with our own capabilities */
+uint32_t edgedata_rpc_capabilities_with_reply(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len)
+{
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   uint32_t capabilities = 0;
+
+   if ((payload_len != sizeof(capabilities)) || (max_payload_reply_len < sizeof(capabilities)))
+   {
+      return 0;
+   }
+   memcpy(&capabilities, payload, sizeof(capabilities));
+   m_fd->peer_capabilities = capabilities & EDGEDATA_CAPABILITIES;
+   m_fd->peer_credits = m_fd->p_recv_message->header.msg_credits;
+   capabilities = EDGEDATA_CAPABILITIES;
+   memcpy(payload_reply, &capabilities, sizeof(capabilities));
+   return sizeof(capabilities);
+}
+
+void edgedata_rpc_dummy_ack(void* fd, unsigned char* p_payload, uint32_t payload_len)
+{
+   /* nothing todo */
+}
+uint32_t edgedata_rpc_dummy_with_reply_ack(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len)
+{
+   /* nothing todo */
+   return 0;
+}
+
+/* only called by recv thread */
+bool edgedata_rpc_recv(EDGEDATA_IPC_FD* fd, uint32_t* p_message_type, uint32_t* p_sequence, uint8_t* p_msg_control_flags, unsigned char** p_payload, uint32_t* p_payload_len)
+{
+   if ((fd == NULL) || (p_payload == NULL) || (p_message_type == NULL))
+   {
+      return false;
+   }
+   if (fd->b_reassembled)
+   {  /* previous large message is processed, keep the capacity for the next one */
+      fd->reassembly.clear();
+      fd->b_reassembled = false;
+   }
+   while (true)
+   {
+      if (!edgedata_ipc_read(fd))
+      {  /* on would block the fragments received so far are kept */
+         fd->b_recv_batch_start = fd->b_would_block;
+         return false;
+      }
+      if (fd->b_recv_batch_start)
+      {
+         fd->b_recv_batch_start = false;
+         edgedata_rpc_credits_refresh(fd);
+      }
+      if (!get_package_info(fd, p_message_type, p_sequence, p_msg_control_flags, p_payload, p_payload_len))
+      {
+         return false;
+      }
+      if (((*p_msg_control_flags & MSG_CONTROL_FLAG_FRAGMENT) == 0) && (fd->reassembly.empty()))
+      {  /* single frame message */
+         return true;
+      }
+      if (fd->reassembly.empty())
+      {
+         fd->reassembly_type = *p_message_type;
+         fd->reassembly_sequence = *p_sequence;
+      }
+      else if ((fd->reassembly_type != *p_message_type) || (fd->reassembly_sequence != *p_sequence))
+      {
+         ERROR_LOG("edgedata_rpc_recv: Fragment of message %d (sequence %d) while message %d (sequence %d) is incomplete\n", *p_message_type, *p_sequence, fd->reassembly_type, fd->reassembly_sequence);
+         fd->reassembly.clear();
+         return false;
+      }
+      if ((fd->reassembly.size() + *p_payload_len) > MSG_MAX_LARGE_PAYLOAD_SIZE)
+      {
+         ERROR_LOG("edgedata_rpc_recv: Message %d exceeds %d bytes\n", *p_message_type, MSG_MAX_LARGE_PAYLOAD_SIZE);
+         fd->reassembly.clear();
+         return false;
+      }
+      fd->reassembly.insert(fd->reassembly.end(), *p_payload, *p_payload + *p_payload_len);
+      fd->statistics.bytes_copied_recv += *p_payload_len;
+      if ((*p_msg_control_flags & MSG_CONTROL_FLAG_FRAGMENT) == 0)
+      {  /* last fragment -> complete message */
+         *p_payload = fd->reassembly.data();
+         *p_payload_len = (uint32_t)fd->reassembly.size();
+         fd->b_reassembled = true;
+         return true;
+      }
+   }
+}
+
+/* *************************************************************************************************************** */
+
+/* ************************************ */
+/* **********CALLBACK LAYER************ */
+/* ************************************ */
+/* one handler of each kind per message type, registering the same handler again is accepted */
+bool edgedata_callback_with_reply_register(EDGEDATA_IPC_FD* fd, uint32_t message_type, fct_callback_message_with_reply cb)
+{
+   if ((fd == NULL) || (cb == NULL) || (message_type >= MSG_TYPE_MAX))
+   {
+      ERROR_LOG("edgedata_callback_with_reply_register: Invalid Message Type %d or Callback\n", message_type);
+      return false;
+   }
+   if ((fd->dispatch[message_type].cb_with_reply != NULL) && (fd->dispatch[message_type].cb_with_reply != cb))
+   {
+      ERROR_LOG("edgedata_callback_with_reply_register: Message Type %d already registered\n", message_type);
+      return false;
+   }
+   fd->dispatch[message_type].cb_with_reply = cb;
+   return true;
+}
+
+bool edgedata_callback_register(EDGEDATA_IPC_FD* fd, uint32_t message_type, fct_callback_message cb)
+{
+   if ((fd == NULL) || (cb == NULL) || (message_type >= MSG_TYPE_MAX))
+   {
+      ERROR_LOG("edgedata_callback_register: Invalid Message Type %d or Callback\n", message_type);
+      return false;
+   }
+   if ((fd->dispatch[message_type].cb != NULL) && (fd->dispatch[message_type].cb != cb))
+   {
+      ERROR_LOG("edgedata_callback_register: Message Type %d already registered\n", message_type);
+      return false;
+   }
+   fd->dispatch[message_type].cb = cb;
+   return true;
+}
+
+static void edgedata_callback_account(EDGEDATA_DISPATCH_ENTRY* entry, int64_t start_ns)
+{
+   entry->calls++;
+   entry->time_ns += (uint64_t)(edgedata_time_ns() - start_ns);
+}
+
+void edgedata_callback_with_reply(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t sequence, unsigned char* payload, uint32_t payload_len)
+{
+   unsigned char payload_reply_frame[MAX_PAYLOAD_SIZE];
+   unsigned char* payload_reply = payload_reply_frame;
+   uint32_t max_payload_reply_len = MAX_PAYLOAD_SIZE;
+   uint32_t payload_reply_len = 0;
+   (void)memset(payload_reply_frame, 0, sizeof(payload_reply_frame));
+
+   if ((fd == NULL) || (payload == NULL))
+   {
+      return;
+   }
+   if (edgedata_rpc_max_payload_len(fd) > MAX_PAYLOAD_SIZE)
+   {  /* peer reassembles large replies (allocated once, only touched pages are used) */
+      if (fd->p_large_reply == NULL)
+      {
+         fd->p_large_reply = new unsigned char[MSG_MAX_LARGE_PAYLOAD_SIZE];
+      }
+      payload_reply = fd->p_large_reply;
+      max_payload_reply_len = MSG_MAX_LARGE_PAYLOAD_SIZE;
+   }
+   if ((message_type < MSG_TYPE_MAX) && (fd->dispatch[message_type].cb_with_reply != NULL))
+   {
+      EDGEDATA_DISPATCH_ENTRY* entry = &fd->dispatch[message_type];
+      int64_t start_ns = edgedata_time_ns();
+      payload_reply_len = entry->cb_with_reply((void*)fd, payload, payload_len, payload_reply, max_payload_reply_len);
+      edgedata_callback_account(entry, start_ns);
+      /* send reply */
+      (void)edgedata_rpc_send_reply(fd, message_type, sequence, payload_reply, payload_reply_len);
+      return;
+   }
+   /* send empty reply */
+   ERROR_LOG("edgedata_callback_with_reply: Error Unknown Message Type %d (Return Empty Reply)\n", message_type);
+   (void)edgedata_rpc_send_reply(fd, message_type, sequence, payload_reply, 0);
+}
+
+/* stream event: processed by the request callback, the reply is replaced by the cumulative ack */
+static void edgedata_callback_stream(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len)
+{
+   unsigned char payload_reply[MAX_PAYLOAD_SIZE];
+
+   if ((fd == NULL) || (payload == NULL))
+   {
+      return;
+   }
+   if ((message_type < MSG_TYPE_MAX) && (fd->dispatch[message_type].cb_with_reply != NULL))
+   {
+      EDGEDATA_DISPATCH_ENTRY* entry = &fd->dispatch[message_type];
+      int64_t start_ns = edgedata_time_ns();
+      (void)entry->cb_with_reply((void*)fd, payload, payload_len, payload_reply, sizeof(payload_reply));
+      edgedata_callback_account(entry, start_ns);
+      return;
+   }
+   ERROR_LOG("edgedata_callback_stream Error: Unknown Message Type: %d\n", message_type);
+}
+
+void edgedata_callback(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t sequence, unsigned char* payload, uint32_t payload_len)
+{
+   if ((fd == NULL) || (payload == NULL))
+   {
+      return;
+   }
+   if ((message_type < MSG_TYPE_MAX) && (fd->dispatch[message_type].cb != NULL))
+   {
+      EDGEDATA_DISPATCH_ENTRY* entry = &fd->dispatch[message_type];
+      int64_t start_ns = edgedata_time_ns();
+      entry->cb((void*)fd, payload, payload_len);
+      edgedata_callback_account(entry, start_ns);
+      return;
+   }
+   ERROR_LOG("edgedata_callback Error: Unknown Message Type: %d\n", message_type);
+}
+
+/* hands a received message to the registered callbacks and releases a waiting request */
+static void edgedata_callback_dispatch(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t sequence, uint8_t control_flags, unsigned char* payload, uint32_t payload_len)
+{
+   if ((control_flags & MSG_CONTROL_FLAG_STREAM) != 0)
+   {
+      edgedata_callback_stream(fd, message_type, payload, payload_len);
+      edgedata_rpc_stream_ack(fd, true);
+      return;
+   }
+   if (is_request(control_flags))
+   {
+      edgedata_callback_with_reply(fd, message_type, sequence, payload, payload_len);
+   }
+   else
+   {
+      edgedata_callback(fd, message_type, sequence, payload, payload_len);
+   }
+
+   if (is_reply(control_flags))
+   {
+      edgedata_rpc_inform_about_response(fd, sequence);
+   }
+}
+
+
+/* ************************************ */
+/* *********** THREAD LAYER *********** */
+/* ************************************ */
+
+
+static void edgedata_thread_ping_done(void* fd, void* context, bool b_ok)
+{
+   /* nothing todo, the reply already refreshed last_recv_ms */
+}
+
+static bool edgedata_thread_recv_watch(EDGEDATA_IPC_FD* fd, int32_t watch_fd)
+{
+   struct epoll_event event;
+   event.events = EPOLLIN;
+   event.data.fd = watch_fd;
+   return (epoll_ctl(fd->recv_epoll_fd, EPOLL_CTL_ADD, watch_fd, &event) == 0);
+}
+
+/* keep alive tick of the receive loop: false if the peer is gone                                        */
+/* server_keep_alive closes a silent client, a ping is sent whenever no request was sent for a while,    */
+/* received messages (e.g. pings of the server) do not suppress it                                       */
+static bool edgedata_thread_keep_alive(EDGEDATA_IPC_FD* fd)
+{
+   int64_t now = edgedata_time_ms();
+   uint32_t sequence = __atomic_load_n(&fd->sequence, __ATOMIC_RELAXED);
+   unsigned char buff[1];
+
+   /* stream events received since the last ack */
+   (void)edgedata_rpc_stream_ack(fd, false);
+   if ((now - fd->last_recv_ms) >= (SOCKET_TIMEOUT_SECONDS * 1000))
+   {
+      ERROR_LOG("Connection timeout\n");
+      return false;
+   }
+   if (sequence != fd->last_send_sequence)
+   {
+      fd->last_send_sequence = sequence;
+      fd->last_send_ms = now;
+   }
+   if ((now - fd->last_send_ms) >= (KEEP_ALIVE_PING_SECONDS * 1000))
+   {  /* idle link: the reply is received by this loop, it must not wait for it */
+      fd->last_send_ms = now;
+      if (!edgedata_rpc_send_request_async(fd, MSG_TYPE_PING, buff, 0, edgedata_thread_ping_done, NULL))
+      {
+         INFO_LOG("Send Ping failed\n");
+         return false;
+      }
+   }
+   return true;
+}
+
+/* sleeps up to timeout_ms (-1: no limit) until the connection is readable, the keep alive timer expires or disconnect is requested */
+static bool edgedata_thread_recv_wait(EDGEDATA_IPC_FD* fd, int32_t timeout_ms)
+{
+   struct epoll_event events[4];
+   int32_t wait_fd = edgedata_ipc_wait_fd(fd);
+   int32_t events_len;
+   uint64_t expirations;
+
+   if (wait_fd != fd->recv_wait_fd)
+   {  /* io_uring fell back to read(), the closed ring fd already left the set */
+      if (!edgedata_thread_recv_watch(fd, wait_fd))
+      {
+         return false;
+      }
+      fd->recv_wait_fd = wait_fd;
+   }
+   events_len = epoll_wait(fd->recv_epoll_fd, events, 4, timeout_ms);
+   if (events_len < 0)
+   {
+      return (errno == EINTR);
+   }
+   for (int32_t i = 0; i < events_len; i++)
+   {
+      if (events[i].data.fd == fd->shutdown_event_fd)
+      {  /* disconnect (b_shutdown) or a deferred credit callback */
+         (void)read(fd->shutdown_event_fd, &expirations, sizeof(expirations));
+      }
+      else if (events[i].data.fd == fd->stream_ack_timer_fd)
+      {  /* armed for an earlier burst: again for the current one */
+         int64_t due_ms;
+         (void)read(fd->stream_ack_timer_fd, &expirations, sizeof(expirations));
+         fd->b_stream_ack_armed = false;
+         due_ms = edgedata_rpc_stream_ack(fd, false);
+         if (due_ms != 0)
+         {
+            edgedata_rpc_stream_ack_arm(fd, due_ms - edgedata_time_ms());
+         }
+      }
+      else if (events[i].data.fd == fd->keep_alive_timer_fd)
+      {
+         (void)read(fd->keep_alive_timer_fd, &expirations, sizeof(expirations));
+         return edgedata_thread_keep_alive(fd);
+      }
+   }
+   return true;
+}
+
+/* dispatches every complete message until the connection would block, false if it is lost or shut down */
+static bool edgedata_thread_recv_dispatch(EDGEDATA_IPC_FD* fd, uint32_t* p_dispatched)
+{
+   uint32_t message_type;
+   uint32_t sequence;
+   uint32_t payload_len;
+   uint8_t  control_flags;
+   unsigned char* payload;
+
+   while (!fd->b_shutdown)
+   {
+      fd->b_would_block = false;
+      if (!edgedata_rpc_recv(fd, &message_type, &sequence, &control_flags, &payload, &payload_len))
+      {
+         return fd->b_would_block;
+      }
+      fd->last_recv_ms = edgedata_time_ms();
+      edgedata_callback_dispatch(fd, message_type, sequence, control_flags, payload, payload_len);
+      (*p_dispatched)++;
+   }
+   return false;
+}
+
+/* end of the receive loop: outstanding requests fail, the channel is closed */
+static void edgedata_thread_recv_close(EDGEDATA_IPC_FD* fd)
+{
+   if (fd->b_shutdown)
+   {
+      INFO_LOG("Manually shutdown requested\n");
+   }
+   else
+   {
+      ERROR_LOG("shutdown caused by recv error\n");
+      if (fd->error_connection_cb != NULL)
+      {
+         fd->error_connection_cb((void*)fd);
+      }
+   }
+   edgedata_rpc_unlock_pending_requests(fd);
+   edgedata_ipc_close(fd);
+}
+
+void* thread_rpc_recv(void* fd)
+{
+   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
+   uint32_t dispatched = 0;
+
+   INFO_LOG("RECV Thread STARTED\n");
+   while ((edgedata_thread_recv_dispatch(m_fd, &dispatched)) && (edgedata_thread_recv_wait(m_fd, -1)))
+   {
+      edgedata_rpc_run_deferred_callbacks(m_fd);
+   }
+   edgedata_thread_recv_close(m_fd);
+   return NULL;
+}
+
+/* reads are non blocking from now on: epoll set of shutdown event, keep alive timer and data source */
+static bool edgedata_thread_recv_setup(EDGEDATA_IPC_FD* fd)
+{
+   struct itimerspec tick;
+
+   fd->shutdown_event_fd = eventfd(0, EFD_CLOEXEC);
+   fd->keep_alive_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   fd->stream_ack_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   fd->recv_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+   if ((fd->shutdown_event_fd < 0) || (fd->keep_alive_timer_fd < 0) || (fd->stream_ack_timer_fd < 0) || (fd->recv_epoll_fd < 0))
+   {
+      ERROR_LOG("Error create receive loop\n");
+      return false;
+   }
+   tick.it_interval.tv_sec = 1;
+   tick.it_interval.tv_nsec = 0;
+   tick.it_value = tick.it_interval;
+   (void)timerfd_settime(fd->keep_alive_timer_fd, 0, &tick, NULL);
+   (void)fcntl(fd->read_fd, F_SETFL, fcntl(fd->read_fd, F_GETFL) | O_NONBLOCK);
+   fd->b_nonblocking = true;
+   fd->last_recv_ms = edgedata_time_ms();
+   fd->last_send_sequence = __atomic_load_n(&fd->sequence, __ATOMIC_RELAXED);
+   fd->last_send_ms = fd->last_recv_ms;
+   fd->recv_wait_fd = edgedata_ipc_wait_fd(fd);
+   if ((!edgedata_thread_recv_watch(fd, fd->shutdown_event_fd)) ||
+      (!edgedata_thread_recv_watch(fd, fd->keep_alive_timer_fd)) ||
+      (!edgedata_thread_recv_watch(fd, fd->stream_ack_timer_fd)) ||
+      (!edgedata_thread_recv_watch(fd, fd->recv_wait_fd)) ||
+      ((fd->shm != NULL) && (!edgedata_thread_recv_watch(fd, fd->shm->recv_event_fd))))
+   {
+      ERROR_LOG("Error add connection to epoll\n");
+      return false;
    }
+   return true;
+}
 
-   /* we set permission here */
-   if (user != NULL)
+/* one thread per connection, or none if the application calls edge_data_process (config.b_process_by_caller) */
+bool edgedata_thread_start_thread_recv(EDGEDATA_IPC_FD* fd)
+{
+   if ((fd == NULL) || (!edgedata_thread_recv_setup(fd)))
    {
-      struct passwd *pw = getpwnam(user);
-      if (pw != NULL)
+      return false;
+   }
+   if (fd->config.b_process_by_caller)
+   {
+      fd->b_recv_by_caller = true;
+      return true;
+   }
+   if (pthread_create(&fd->p_thread_recv, NULL, &thread_rpc_recv, fd) != 0)
+   {
+      ERROR_LOG("Error create receive thread\n");
+      return false;
+   }
+   fd->b_recv_thread = true;
+   if ((fd->config.recv_thread_cpu >= 0) && (fd->config.recv_thread_cpu < CPU_SETSIZE))
+   {  /* keeps the cache warm, e.g. together with busy poll */
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(fd->config.recv_thread_cpu, &cpu_set);
+      if (pthread_setaffinity_np(fd->p_thread_recv, sizeof(cpu_set), &cpu_set) != 0)
       {
-         (void)chown(addr.sun_path, pw->pw_uid, pw->pw_gid);
+         ERROR_LOG("Pin receive thread to CPU %d failed\n", fd->config.recv_thread_cpu);
       }
-      (void)chmod(addr.sun_path, 0777);
    }
+   return true;
+}
 
-   listen(listen_socket, 5);
-   socklen_t addrlen = sizeof(struct sockaddr_in);
-   fd->write_fd = accept(listen_socket,
-      (struct sockaddr*) & addr,
-      &addrlen);
+/* receive loop on the caller thread (no receive thread): dispatches what is available, only if there was nothing */
+/* it waits up to timeout_ms, false if the connection is lost. Also used by the RPC layer while it waits for a reply. */
+bool edgedata_thread_recv_process(EDGEDATA_IPC_FD* fd, int32_t timeout_ms)
+{
+   bool ret = true;
+   uint32_t dispatched = 0;
+   if (!fd->b_connected)
+   {
+      return false;
+   }
+   fd->b_recv_busy = true;
+   if ((!edgedata_thread_recv_dispatch(fd, &dispatched)) ||
+      ((dispatched == 0) && ((!edgedata_thread_recv_wait(fd, timeout_ms)) || (!edgedata_thread_recv_dispatch(fd, &dispatched)))))
+   {
+      edgedata_thread_recv_close(fd);
+      ret = false;
+   }
+   fd->b_recv_busy = false;
+   return ret;
+}
 
-   close(listen_socket);
-   if (fd->write_fd <= 0)
+/* ********** SERVER LOOP ************* */
+/* All connections of a server are read by one thread. Connections are non blocking,  */
+/* writes queue what the peer does not take and the loop sends it on EPOLLOUT. A       */
+/* connection is freed when the loop and all broadcasts released it.                  */
+
+static void server_release_connections(EDGEDATA_IPC_SERVER* server, std::vector<EDGEDATA_IPC_FD*>& connections)
+{
+   std::vector<EDGEDATA_IPC_FD*> released;
+   pthread_mutex_lock(&server->connections_mutex);
+   for (uint32_t i = 0; i < connections.size(); i++)
    {
-      edgedata_data_cleanup(&fd);
-      ERROR_LOG("Error accept unix socket\n");
-      return NULL;
+      connections[i]->ref_count--;
+      if (connections[i]->ref_count == 0)
+      {
+         released.push_back(connections[i]);
+      }
    }
-   fd->read_fd = fd->write_fd;
+   pthread_mutex_unlock(&server->connections_mutex);
+   connections.clear();
+   for (uint32_t i = 0; i < released.size(); i++)
+   {
+      edgedata_data_cleanup(&released[i]);
+   }
+}
 
-   /* set read socket timeout */
-   setsockopt(fd->read_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
-   setsockopt(fd->read_fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof tv);
-   return fd;
+/* called only by the loop, the connection is released after the current epoll events */
+static void server_close_connection(EDGEDATA_IPC_SERVER* server, EDGEDATA_IPC_FD* fd)
+{
+   if (!fd->b_connected)
+   {
+      return;
+   }
+   INFO_LOG("Server connection closed\n");
+   (void)epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, fd->read_fd, NULL);
+   if (fd->b_shm_polled)
+   {
+      (void)epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, fd->shm->recv_event_fd, NULL);
+   }
+   edgedata_ipc_close(fd);
+   edgedata_rpc_unlock_pending_requests(fd);
+   if (server->disconnected_cb != NULL)
+   {
+      server->disconnected_cb((void*)fd);
+   }
+   pthread_mutex_lock(&server->connections_mutex);
+   for (uint32_t i = 0; i < server->connections.size(); i++)
+   {
+      if (server->connections[i] == fd)
+      {
+         server->connections.erase(server->connections.begin() + i);
+         break;
+      }
+   }
+   pthread_mutex_unlock(&server->connections_mutex);
+   server->closed_connections.push_back(fd);
 }
 
-EDGEDATA_IPC_FD* edgedata_ipc_unix_client_connect(const char* channel_name)
+/* socket_fd must be non blocking */
+static void server_add_connection(EDGEDATA_IPC_SERVER* server, int32_t socket_fd)
 {
-   EDGEDATA_IPC_FD* fd = ipc_new_fd(true);
-   struct timeval tv;
-   tv.tv_sec = SOCKET_TIMEOUT_SECONDS;
-   tv.tv_usec = 0;
-   fd->read_channel_name = string(channel_name);
-   fd->write_channel_name = string(channel_name);
-   fd->read = edgedata_ipc_basic_read;
-   fd->write = edgedata_ipc_basic_write;
-   fd->error_connection_cb = NULL;
+   struct epoll_event event;
+   EDGEDATA_IPC_FD* fd = ipc_new_fd(server->b_channel_type_stream);
+   ipc_unix_server_fd_init(fd, server->channel_name.c_str());
+   fd->read_fd = socket_fd;
+   fd->write_fd = socket_fd;
+   fd->b_nonblocking = true;
+   fd->b_send_queue = true;
+   fd->server_wake_fd = server->wake_fd;
+   /* one loop serves all connections, it must not spin on one of them */
+   fd->config.busy_poll_us = 0;
+   fd->ref_count = 1;
+   fd->last_recv_ms = edgedata_time_ms();
+   fd->last_ping_ms = fd->last_recv_ms;
+   INFO_LOG("Server connection accepted\n");
+   if (server->connected_cb != NULL)
+   {
+      server->connected_cb((void*)fd);
+   }
+   pthread_mutex_lock(&server->connections_mutex);
+   server->connections.push_back(fd);
+   pthread_mutex_unlock(&server->connections_mutex);
 
-   //catch SIGPIPE error
-   signal(SIGPIPE, SIG_IGN);//pipe_close_handler);  // SIG_IGN ignores it
+   event.events = EPOLLIN;
+   event.data.ptr = fd;
+   if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, socket_fd, &event) != 0)
+   {
+      ERROR_LOG("Error add connection to epoll\n");
+      server_close_connection(server, fd);
+   }
+}
 
-   fd->write_fd = socket(PF_LOCAL, SOCK_STREAM, 0);
-   fd->read_fd = fd->write_fd;
+static void server_accept(EDGEDATA_IPC_SERVER* server)
+{
+   while (true)
+   {
+      int32_t socket_fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (socket_fd < 0)
+      {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+         if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+         {
+            ERROR_LOG("Error accept unix socket\n");
+         }
+         return;
+      }
+      server_add_connection(server, socket_fd);
+   }
+}
+
+/* reads every complete message of a connection until the socket would block */
+static void server_recv(EDGEDATA_IPC_SERVER* server, EDGEDATA_IPC_FD* fd)
+{
+   uint32_t message_type;
+   uint32_t sequence;
+   uint32_t payload_len;
+   uint8_t  control_flags;
+   unsigned char* payload;
+   struct epoll_event event;
 
-   if (fd->write_fd < 0)
+   while (fd->b_connected)
    {
-      edgedata_data_cleanup(&fd);
-      ERROR_LOG("Error create unix socket\n");
-      return NULL;
+      fd->b_would_block = false;
+      if (!edgedata_rpc_recv(fd, &message_type, &sequence, &control_flags, &payload, &payload_len))
+      {
+         if (!fd->b_would_block)
+         {
+            server_close_connection(server, fd);
+         }
+         return;
+      }
+      fd->last_recv_ms = edgedata_time_ms();
+      edgedata_callback_dispatch(fd, message_type, sequence, control_flags, payload, payload_len);
+
+      if ((fd->shm != NULL) && (!fd->b_shm_polled))
+      {  /* switched to shared memory, data is announced by the event fd from now on */
+         event.events = EPOLLIN;
+         event.data.ptr = fd;
+         if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd->shm->recv_event_fd, &event) != 0)
+         {
+            ERROR_LOG("Error add shared memory to epoll\n");
+            server_close_connection(server, fd);
+            return;
+         }
+         fd->b_shm_polled = true;
+      }
    }
-   struct sockaddr_un addr;
-   memset(&addr, 0, sizeof(addr));
-   addr.sun_family = AF_LOCAL;
-   if (fd->read_channel_name.length() >= sizeof(addr.sun_path))
+}
+
+/* sends the queued messages, EPOLLOUT is armed while a socket does not take them */
+/* (a full shared memory ring has no event, the loop cycles with SERVER_SHM_FLUSH_MS) */
+static void server_flush(EDGEDATA_IPC_SERVER* server)
+{
+   std::vector<EDGEDATA_IPC_FD*> queued;
+   struct epoll_event event;
+
+   server->b_shm_send_queued = false;
+   for (uint32_t i = 0; i < server->connections.size(); i++)
    {
-      close(fd->read_fd);
-      edgedata_data_cleanup(&fd);
-      ERROR_LOG("Error: channel name too long for unix socket path\n");
-      return NULL;
+      if (server->connections[i]->b_send_queued)
+      {
+         queued.push_back(server->connections[i]);
+      }
    }
-   strncpy(addr.sun_path, fd->read_channel_name.c_str(), sizeof(addr.sun_path) - 1);
-   addr.sun_path[sizeof(addr.sun_path) - 1] = '\0';
+   for (uint32_t i = 0; i < queued.size(); i++)
+   {
+      EDGEDATA_IPC_FD* fd = queued[i];
+      bool b_waiting;
+      if (!edgedata_ipc_queue_flush(fd))
+      {
+         server_close_connection(server, fd);
+         continue;
+      }
+      b_waiting = fd->b_send_queued;
+      if (fd->shm != NULL)
+      {
+         server->b_shm_send_queued = server->b_shm_send_queued || b_waiting;
+      }
+      else if (b_waiting != fd->b_epollout)
+      {
+         event.events = (b_waiting) ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+         event.data.ptr = fd;
+         if (epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, fd->read_fd, &event) != 0)
+         {
+            ERROR_LOG("Error modify connection epoll\n");
+            server_close_connection(server, fd);
+            continue;
+         }
+         fd->b_epollout = b_waiting;
+      }
+   }
+}
 
-   if (connect(fd->read_fd, (struct sockaddr*) & addr, sizeof(addr)) == -1)
+/* the end of an event burst is acknowledged EVENT_STREAM_ACK_MS after its first event, */
+/* stream_ack_due_ms limits the epoll timeout until then (the stream timer of a client) */
+static void server_stream_ack(EDGEDATA_IPC_SERVER* server)
+{
+   server->stream_ack_due_ms = 0;
+   for (uint32_t i = 0; i < server->connections.size(); i++)
    {
-      close(fd->read_fd);
-      edgedata_data_cleanup(&fd);
-      ERROR_LOG("Error connect unix socket\n");
-      return NULL;
+      EDGEDATA_IPC_FD* fd = server->connections[i];
+      if (fd->stream_received != fd->stream_ack_sent)
+      {  /* both are written by this loop only */
+         int64_t due_ms = edgedata_rpc_stream_ack(fd, false);
+         if ((due_ms != 0) && ((server->stream_ack_due_ms == 0) || (due_ms < server->stream_ack_due_ms)))
+         {
+            server->stream_ack_due_ms = due_ms;
+         }
+      }
    }
-   setsockopt(fd->read_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
-   setsockopt(fd->read_fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof tv);
-   return fd;
 }
 
-/* ************************************ */
-/* **************RPC LAYER************* */
-/* ************************************ */
+/* same behaviour as the keep alive timer of a single connection */
+static void server_keep_alive(EDGEDATA_IPC_SERVER* server)
+{
+   int64_t now = edgedata_time_ms();
+   std::vector<EDGEDATA_IPC_FD*> connections = server->connections;
+   unsigned char buff[1];
 
-static bool is_request(uint8_t control_flags)
+   for (uint32_t i = 0; i < connections.size(); i++)
+   {
+      EDGEDATA_IPC_FD* fd = connections[i];
+      (void)edgedata_rpc_stream_ack(fd, false);
+      if ((now - fd->last_recv_ms) >= (SOCKET_TIMEOUT_SECONDS * 1000))
+      {
+         ERROR_LOG("Server connection timeout\n");
+         server_close_connection(server, fd);
+      }
+      else if (((now - fd->last_recv_ms) >= (KEEP_ALIVE_PING_SECONDS * 1000)) && ((now - fd->last_ping_ms) >= (KEEP_ALIVE_PING_SECONDS * 1000)))
+      {
+         fd->last_ping_ms = now;
+         if (!edgedata_rpc_send_fire_and_forget(fd, MSG_TYPE_PING, buff, 0))
+         {
+            server_close_connection(server, fd);
+         }
+      }
+   }
+}
+
+/* channel_name NULL -> no listen socket (loopback connections only) */
+static EDGEDATA_IPC_SERVER* server_create(const char* channel_name, const char* user, fct_server_connection connected_cb, fct_server_connection disconnected_cb)
 {
-   if ((control_flags & MSG_CONTROL_FLAG_REQUEST) != 0)
+   struct epoll_event event;
+   EDGEDATA_IPC_SERVER* server = new EDGEDATA_IPC_SERVER();
+
+   server->channel_name = string((channel_name != NULL) ? channel_name : "loopback");
+   server->b_channel_type_stream = !edgedata_ipc_config.b_seqpacket;
+   server->connected_cb = connected_cb;
+   server->disconnected_cb = disconnected_cb;
+   server->connections_mutex = PTHREAD_MUTEX_INITIALIZER;
+   server->last_keep_alive_ms = edgedata_time_ms();
+   server->stream_ack_due_ms = 0;
+   server->b_shm_send_queued = false;
+   server->b_thread_started = false;
+   server->b_shutdown = false;
+   /* catch SIGPIPE error */
+   signal(SIGPIPE, SIG_IGN);
+
+   server->listen_fd = -1;
+   server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+   server->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+   if ((server->epoll_fd < 0) || (server->wake_fd < 0))
    {
-      return true;
+      ERROR_LOG("Error create server\n");
+      edgedata_ipc_server_close(&server);
+      return NULL;
    }
-   return false;
+   /* data.ptr: NULL -> listen socket, server -> wake up, otherwise the connection */
+   event.events = EPOLLIN;
+   event.data.ptr = server;
+   if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &event) != 0)
+   {
+      ERROR_LOG("Error setup server epoll\n");
+      edgedata_ipc_server_close(&server);
+      return NULL;
+   }
+   if (channel_name != NULL)
+   {
+      server->listen_fd = ipc_unix_listen_socket(channel_name, user, server->b_channel_type_stream, SOMAXCONN);
+      event.data.ptr = NULL;
+      if ((server->listen_fd < 0) || (fcntl(server->listen_fd, F_SETFL, fcntl(server->listen_fd, F_GETFL) | O_NONBLOCK) != 0) ||
+         (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event) != 0))
+      {
+         ERROR_LOG("Error setup server listen socket\n");
+         edgedata_ipc_server_close(&server);
+         return NULL;
+      }
+   }
+   return server;
 }
 
-static bool is_reply(uint8_t control_flags)
+EDGEDATA_IPC_SERVER* edgedata_ipc_unix_server_create(const char* channel_name, const char* user, fct_server_connection connected_cb, fct_server_connection disconnected_cb)
 {
-   if ((control_flags & MSG_CONTROL_FLAG_REPLY) != 0)
+   if (channel_name == NULL)
    {
-      return true;
+      return NULL;
    }
-   return false;
+   return server_create(channel_name, user, connected_cb, disconnected_cb);
 }
 
-static uint32_t new_sequence_number(EDGEDATA_IPC_FD* fd)
+/* server for in-process connections (tests, benchmarks), see edgedata_ipc_loopback_connect */
+EDGEDATA_IPC_SERVER* edgedata_ipc_loopback_server_create(fct_server_connection connected_cb, fct_server_connection disconnected_cb)
 {
-   fd->sequence++;
-   return fd->sequence;
+   return server_create(NULL, NULL, connected_cb, disconnected_cb);
 }
 
-static bool set_package_info(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t reply_sequence, uint8_t control_flags, unsigned char* p_msg_payload, uint32_t msg_payload_len)
+/* waits up to timeout_ms for events and serves them, false on fatal error */
+bool edgedata_ipc_server_process(EDGEDATA_IPC_SERVER* server, int32_t timeout_ms)
 {
-   EDGEDATA_RPC_HEADER* header;
-   if ((fd == NULL) || (p_msg_payload == NULL) || (msg_payload_len > MAX_PAYLOAD_SIZE))
+   struct epoll_event events[SERVER_MAX_EVENTS];
+   int32_t events_len;
+   int64_t now;
+
+   if (server == NULL)
    {
       return false;
    }
-   header = (EDGEDATA_RPC_HEADER*)&fd->send_message.header;
-   memset(header, 0, sizeof(EDGEDATA_RPC_HEADER));
-   /* set header */
-   header->msg_type = message_type;
-   header->msg_payload_len = msg_payload_len;
-   header->msg_control_flags = control_flags;
-
-   if (is_reply(control_flags))
-   {  /* use sequence from response */
-      header->msg_sequence = reply_sequence;
+   if ((server->b_shm_send_queued) && ((timeout_ms < 0) || (timeout_ms > SERVER_SHM_FLUSH_MS)))
+   {
+      timeout_ms = SERVER_SHM_FLUSH_MS;
    }
-   else
-   {  /* create new sequence number */
-      header->msg_sequence = new_sequence_number(fd);
+   if (server->stream_ack_due_ms != 0)
+   {
+      int64_t remaining_ms = server->stream_ack_due_ms - edgedata_time_ms();
+      remaining_ms = (remaining_ms > 0) ? remaining_ms : 0;
+      if ((timeout_ms < 0) || (timeout_ms > remaining_ms))
+      {
+         timeout_ms = (int32_t)remaining_ms;
+      }
    }
-
-   /* set payload */
-   memcpy(&fd->send_message.payload, p_msg_payload, msg_payload_len);
+   events_len = epoll_wait(server->epoll_fd, events, SERVER_MAX_EVENTS, timeout_ms);
+   if (events_len < 0)
+   {
+      if (errno != EINTR)
+      {
+         ERROR_LOG("Error epoll wait\n");
+         return false;
+      }
+      events_len = 0;
+   }
+   for (int32_t i = 0; i < events_len; i++)
+   {
+      if (events[i].data.ptr == NULL)
+      {
+         server_accept(server);
+      }
+      else if (events[i].data.ptr == server)
+      {  /* shutdown or new loopback connections */
+         uint64_t counter;
+         std::vector<int32_t> pending_sockets;
+         (void)read(server->wake_fd, &counter, sizeof(counter));
+         pthread_mutex_lock(&server->connections_mutex);
+         pending_sockets.swap(server->pending_sockets);
+         pthread_mutex_unlock(&server->connections_mutex);
+         for (uint32_t j = 0; j < pending_sockets.size(); j++)
+         {
+            server_add_connection(server, pending_sockets[j]);
+         }
+      }
+      else if ((events[i].events & ~EPOLLOUT) != 0)
+      {  /* closed connections stay allocated until all events are processed, EPOLLOUT is served by server_flush */
+         server_recv(server, (EDGEDATA_IPC_FD*)events[i].data.ptr);
+      }
+   }
+   server_flush(server);
+   server_stream_ack(server);
+   now = edgedata_time_ms();
+   if ((now - server->last_keep_alive_ms) >= 1000)
+   {
+      server->last_keep_alive_ms = now;
+      server_keep_alive(server);
+   }
+   server_release_connections(server, server->closed_connections);
    return true;
 }
 
-static bool get_package_info(EDGEDATA_IPC_FD* fd, uint32_t* p_message_type, uint32_t* p_sequence, uint8_t* p_msg_control_flags, unsigned char** p_payload, uint32_t* p_payload_len)
+/* calls cb for every open connection, must not send requests from the loop thread */
+uint32_t edgedata_ipc_server_broadcast(EDGEDATA_IPC_SERVER* server, fct_server_broadcast cb, void* context)
 {
-   EDGEDATA_RPC_HEADER* header;
+   std::vector<EDGEDATA_IPC_FD*> connections;
+   uint32_t count = 0;
 
-   if ((fd == NULL) || (p_message_type == NULL) || (p_sequence == NULL) || (p_msg_control_flags == NULL) || (p_payload == NULL) || (p_payload_len == NULL))
+   if ((server == NULL) || (cb == NULL))
    {
-      return false;
+      return 0;
    }
-   header = (EDGEDATA_RPC_HEADER*)&fd->recv_message.header;
-   *p_message_type = header->msg_type;
-   *p_sequence = header->msg_sequence;
-   *p_payload_len = header->msg_payload_len;
-   *p_msg_control_flags = fd->recv_message.header.msg_control_flags;
-   *p_payload = fd->recv_message.payload;
-   return true;
+   pthread_mutex_lock(&server->connections_mutex);
+   connections = server->connections;
+   for (uint32_t i = 0; i < connections.size(); i++)
+   {
+      connections[i]->ref_count++;
+   }
+   pthread_mutex_unlock(&server->connections_mutex);
+
+   for (uint32_t i = 0; i < connections.size(); i++)
+   {
+      if (edgedata_ipc_is_connected(connections[i]))
+      {
+         cb((void*)connections[i], context);
+         count++;
+      }
+   }
+   server_release_connections(server, connections);
+   return count;
 }
 
-static bool wait_for_response(EDGEDATA_IPC_FD* fd)
+/* in-process connection to server via socketpair, returns the client side */
+EDGEDATA_IPC_FD* edgedata_ipc_loopback_connect(EDGEDATA_IPC_SERVER* server)
 {
-   ENTER_WAIT_FOR_REPLY(fd);
-   if (fd->b_wait_for_reply_error)
+   int32_t sockets[2];
+   struct timeval tv;
+   uint64_t counter = 1;
+   EDGEDATA_IPC_FD* fd;
+
+   if (server == NULL)
    {
-      return false;
+      return NULL;
    }
-   return true;
+   if (socketpair(AF_LOCAL, ((server->b_channel_type_stream) ? SOCK_STREAM : SOCK_SEQPACKET) | SOCK_CLOEXEC, 0, sockets) != 0)
+   {
+      ERROR_LOG("Error create socketpair\n");
+      return NULL;
+   }
+   if (fcntl(sockets[1], F_SETFL, fcntl(sockets[1], F_GETFL) | O_NONBLOCK) != 0)
+   {
+      ERROR_LOG("Error set loopback socket non blocking\n");
+      close(sockets[0]);
+      close(sockets[1]);
+      return NULL;
+   }
+   fd = ipc_new_fd(server->b_channel_type_stream);
+   ipc_unix_client_fd_init(fd, server->channel_name.c_str());
+   fd->read_fd = sockets[0];
+   fd->write_fd = sockets[0];
+   tv.tv_sec = SOCKET_TIMEOUT_SECONDS;
+   tv.tv_usec = 0;
+   setsockopt(fd->read_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
+   setsockopt(fd->read_fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof tv);
+
+   /* the server side is set up by the loop, messages wait in the socket until then */
+   pthread_mutex_lock(&server->connections_mutex);
+   server->pending_sockets.push_back(sockets[1]);
+   pthread_mutex_unlock(&server->connections_mutex);
+   (void)write(server->wake_fd, &counter, sizeof(counter));
+   return fd;
 }
 
-static void edgedata_rpc_inform_about_response(EDGEDATA_IPC_FD* fd, uint32_t sequence)
+void edgedata_ipc_server_close(EDGEDATA_IPC_SERVER** server)
 {
-   if ((fd->b_wait_for_reply) && (fd->wait_for_reply_sequence == sequence))
+   if ((server == NULL) || (*server == NULL))
+   {
+      return;
+   }
+   (*server)->b_shutdown = true;
+   if ((*server)->b_thread_started)
    {
-      fd->b_wait_for_reply = false;
-      fd->b_wait_for_reply_error = false;
-      LEAVE_WAIT_FOR_REPLY(fd);
+      uint64_t counter = 1;
+      (void)write((*server)->wake_fd, &counter, sizeof(counter));
+      pthread_join((*server)->p_thread_server, NULL);
    }
-}
-
-void edgedata_rpc_unlock_wait_for_reply_by_timeout(EDGEDATA_IPC_FD* fd)
-{
-   /* remove wait for reply lock  */
-   if (fd->b_wait_for_reply)
+   std::vector<EDGEDATA_IPC_FD*> connections = (*server)->connections;
+   for (uint32_t i = 0; i < connections.size(); i++)
    {
-      fd->b_wait_for_reply_error = true;
-      LEAVE_WAIT_FOR_REPLY(fd);
+      server_close_connection(*server, connections[i]);
    }
-}
-
-static bool edgedata_rpc_send(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t reply_sequence, uint8_t control_flags, unsigned char* payload, uint32_t payload_len)
-{
-   bool ret = false;
-   if ((fd == NULL) || (payload == NULL))
+   server_release_connections(*server, (*server)->closed_connections);
+   for (uint32_t i = 0; i < (*server)->pending_sockets.size(); i++)
    {
-      return false;
+      close((*server)->pending_sockets[i]);
    }
-   /* avoids mulitple concurrent requests at the same time (waiting for a reply) */
-   if (is_request(control_flags))
+   if ((*server)->listen_fd >= 0)
    {
-      pthread_mutex_lock(&fd->single_concurrent_request_mutex);
+      close((*server)->listen_fd);
    }
-
-   ENTER_CRITICAL_SECTION(fd);
-   if ((fd->b_connected) && (fd->write_fd != 0) && (fd->read_fd != 0))
+   if ((*server)->epoll_fd >= 0)
    {
-      /* setup header */
-      if (set_package_info(fd, message_type, reply_sequence, control_flags, payload, payload_len))
-      {
-         if (is_request(control_flags))
-         {
-            /* mark sequence number as wait for */
-            fd->b_wait_for_reply = true;
-            fd->wait_for_reply_sequence = fd->send_message.header.msg_sequence;
-         }
-         DEBUG_RPC_LOG("try to write\n");
-         if (edgedata_ipc_write(fd))
-         {
-            DEBUG_RPC_LOG("write finished (Payload: %d)\n", fd->send_message.header.msg_payload_len);
-            if (is_request(control_flags))
-            {  /* its a request */
-               DEBUG_LOCK_LOG("Wait for reponse (messagetype: %d)\n", message_type);
-               LEAVE_CRITICAL_SECTION(fd);
-               ret = wait_for_response(fd);
-               DEBUG_LOCK_LOG("Wait for reponse -> Released\n");
-               pthread_mutex_unlock(&fd->single_concurrent_request_mutex);
-               return ret;
-            }
-            else
-            {  /* e.g. fire and forget or reply */
-               ret = true;;
-            }
-         }
-         else
-         {
-            ERROR_LOG("Error write message\n");
-         }
-      }
-      else
-      {
-         ERROR_LOG("RPC send failed (connection already closed)");
-      }
+      close((*server)->epoll_fd);
    }
-   LEAVE_CRITICAL_SECTION(fd);
-   if (is_request(control_flags))
+   if ((*server)->wake_fd >= 0)
    {
-      pthread_mutex_unlock(&fd->single_concurrent_request_mutex);
+      close((*server)->wake_fd);
    }
-   return ret;
+   delete (*server);
+   *server = NULL;
 }
 
-bool edgedata_rpc_send_fire_and_forget(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len)
-{
-   return edgedata_rpc_send(fd, message_type, 0, 0, payload, payload_len);
-}
-bool edgedata_rpc_send_request(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len)
-{
-   return edgedata_rpc_send(fd, message_type, 0, MSG_CONTROL_FLAG_REQUEST, payload, payload_len);
-}
-bool edgedata_rpc_send_reply(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t reply_sequence, unsigned char* payload, uint32_t payload_len)
+void* thread_server(void* server)
 {
-   return edgedata_rpc_send(fd, message_type, reply_sequence, MSG_CONTROL_FLAG_REPLY, payload, payload_len);
-}
+   EDGEDATA_IPC_SERVER* m_server = (EDGEDATA_IPC_SERVER*)server;
 
-void edgedata_rpc_dummy_ack(void* fd, unsigned char* p_payload, uint32_t payload_len)
-{
-   /* nothing todo */
-}
-uint32_t edgedata_rpc_dummy_with_reply_ack(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len)
-{
-   /* nothing todo */
-   return 0;
+   INFO_LOG("Server Thread STARTED\n");
+   while (!m_server->b_shutdown)
+   {
+      if (!edgedata_ipc_server_process(m_server, SERVER_LOOP_TIMEOUT_MS))
+      {
+         break;
+      }
+   }
+   return NULL;
 }
 
-/* only called by recv thread */
-bool edgedata_rpc_recv(EDGEDATA_IPC_FD* fd, uint32_t* p_message_type, uint32_t* p_sequence, uint8_t* p_msg_control_flags, unsigned char** p_payload, uint32_t* p_payload_len)
+void edgedata_thread_start_server(EDGEDATA_IPC_SERVER* server)
 {
-   if ((fd == NULL) || (p_payload == NULL) || (p_message_type == NULL))
-   {
-      return false;
-   }
-   if (!edgedata_ipc_read(fd))
+   if (server == NULL)
    {
-      return false;
+      return;
    }
-   if (!get_package_info(fd, p_message_type, p_sequence, p_msg_control_flags, p_payload, p_payload_len))
+   if (pthread_create(&server->p_thread_server, NULL, &thread_server, server) == 0)
    {
-      return false;
+      server->b_thread_started = true;
    }
-   return true;
 }
 
 /* *************************************************************************************************************** */
 
 /* ************************************ */
-/* **********CALLBACK LAYER************ */
+/* *********Edge Data  LAYER*********** */
 /* ************************************ */
-void edgedata_callback_with_reply_register(EDGEDATA_IPC_FD* fd, uint32_t message_type, fct_callback_message_with_reply cb)
-{
-   EDGEDATA_CALLBACK_WITH_REPLY cb_info;
-   cb_info.message_type = message_type;
-   cb_info.cb = cb;
-   fd->callbacks_with_reply.push_back(cb_info);
-}
 
-void edgedata_callback_register(EDGEDATA_IPC_FD* fd, uint32_t message_type, fct_callback_message cb)
+/* edge_data_list points into the handle vectors, filled once per connection after discover. A vector which is too */
+/* small for a new connection is retired, not freed: handle lists fetched before a reconnect never dangle.          */
+static std::vector<T_EDGE_DATA_HANDLE> edge_data_read_handles;
+static std::vector<T_EDGE_DATA_HANDLE> edge_data_write_handles;
+static std::vector<std::vector<T_EDGE_DATA_HANDLE> > edge_data_retired_handles;
+static T_EDGE_DATA_LIST edge_data_list = { NULL, 0, NULL, 0 };
+static pthread_mutex_t edge_data_access_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* edge_data_get_event_fd, created on first use and kept across reconnects */
+static int32_t edge_data_event_fd = -1;
+/* edge_data_sync_read runs without edge_data_access_mutex, edgedata_data_cleanup waits until it left the values */
+static std::atomic<uint32_t> edge_data_readers(0);
+
+/* ************ VALUE TABLE *********** */
+/* handles are mostly consecutive or strided, spread them over the slots */
+static inline uint32_t edgedata_data_table_hash(uint32_t handle, uint32_t mask)
 {
-   EDGEDATA_CALLBACK cb_info;
-   cb_info.message_type = message_type;
-   cb_info.cb = cb;
-   fd->callbacks.push_back(cb_info);
+   uint32_t hash = handle * 0x9E3779B1u;
+   return (hash ^ (hash >> 15)) & mask;
 }
 
-void edgedata_callback_with_reply(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t sequence, unsigned char* payload, uint32_t payload_len)
+/* topics are compared with strncmp(..., 100), only these characters count */
+static uint32_t edgedata_data_topic_hash(const char* topic)
 {
-   unsigned char payload_reply[MAX_PAYLOAD_SIZE];
-   uint32_t payload_reply_len = 0;
-   (void)memset(payload_reply, 0, sizeof(payload_reply));
-
-   if ((fd == NULL) || (payload == NULL))
+   uint32_t hash = 2166136261u;
+   for (uint32_t i = 0; (i < 100) && (topic[i] != '\0'); i++)
    {
-      return;
+      hash = (hash ^ (uint8_t)topic[i]) * 16777619u;
    }
-   for (uint32_t i = 0; i < fd->callbacks_with_reply.size(); i++)
+   return hash;
+}
+
+static void edgedata_data_table_place(std::vector<uint64_t>& slots, uint32_t key, uint32_t entry_pos)
+{
+   uint32_t mask = (uint32_t)slots.size() - 1;
+   uint32_t pos = edgedata_data_table_hash(key, mask);
+   while (slots[pos] != 0)
    {
-      if (fd->callbacks_with_reply[i].message_type == message_type)
-      {
-         payload_reply_len = fd->callbacks_with_reply[i].cb((void*)fd, payload, payload_len, payload_reply, MAX_PAYLOAD_SIZE);
-         /* send reply */
-         (void)edgedata_rpc_send_reply(fd, message_type, sequence, payload_reply, payload_reply_len);
-         return;
-      }
+      pos = (pos + 1) & mask;
    }
-   /* send empty reply */
-   ERROR_LOG("edgedata_callback_with_reply: Error Unknown Message Type %d (Return Empty Reply)\n", message_type);
-   (void)edgedata_rpc_send_reply(fd, message_type, sequence, payload_reply, 0);
+   slots[pos] = ((uint64_t)key << 32) | (uint64_t)(entry_pos + 1);
 }
 
-void edgedata_callback(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t sequence, unsigned char* payload, uint32_t payload_len)
+/* entry position of the handle, -1 if unknown */
+static int32_t edgedata_data_table_find_pos(EDGEDATA_VALUE_TABLE* table, uint32_t handle)
 {
-   if ((fd == NULL) || (payload == NULL))
+   if (table->slots.empty())
    {
-      return;
+      return -1;
    }
-   for (uint32_t i = 0; i < fd->callbacks.size(); i++)
+   uint32_t mask = (uint32_t)table->slots.size() - 1;
+   for (uint32_t pos = edgedata_data_table_hash(handle, mask);; pos = (pos + 1) & mask)
    {
-      if (fd->callbacks[i].message_type == message_type)
+      uint64_t slot = table->slots[pos];
+      if ((uint32_t)slot == 0)
       {
-         fd->callbacks[i].cb((void*)fd, payload, payload_len);
-         return;
+         return -1;
+      }
+      if ((uint32_t)(slot >> 32) == handle)
+      {
+         return (int32_t)((uint32_t)slot - 1);
       }
    }
-   ERROR_LOG("edgedata_callback Error: Unknown Message Type: %d\n", message_type);
 }
 
-
-/* ************************************ */
-/* *********** THREAD LAYER *********** */
-/* ************************************ */
-
-
-void* thread_rpc_keep_alive(void* fd)
+static EDGEDATA_VALUES* edgedata_data_table_find(EDGEDATA_VALUE_TABLE* table, uint32_t handle)
 {
-   uint32_t seconds_not_alive = 0;
-   uint32_t latest_sequence = 0;
-   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
-   edgedata_callback_register(m_fd, MSG_TYPE_PING, edgedata_rpc_dummy_ack);
-   edgedata_callback_with_reply_register(m_fd, MSG_TYPE_PING, edgedata_rpc_dummy_with_reply_ack);
+   int32_t entry_pos = edgedata_data_table_find_pos(table, handle);
+   return (entry_pos < 0) ? NULL : &table->entries[entry_pos];
+}
 
-   INFO_LOG("Keep Alive Thread STARTED\n");
-   while (!m_fd->b_shutdown)
+/* set by the receive thread after internal changed */
+static void edgedata_data_table_set_dirty(EDGEDATA_VALUE_TABLE* table, uint32_t entry_pos)
+{
+   uint64_t bit = (uint64_t)1 << (entry_pos % 64);
+   if ((__atomic_load_n(&table->dirty[entry_pos / 64], __ATOMIC_RELAXED) & bit) == 0)
    {
-      sleep(1);
-      if (m_fd->b_shutdown)
-      {
-         break;
-      }
-      //INFO_LOG("Compare RPC Sequence %d with latest %d\n", m_fd->sequence, latest_sequence);
-      if (m_fd->sequence == latest_sequence)
-      {
-         seconds_not_alive++;
-      }
-      else
-      {
-         seconds_not_alive = 0;
-         latest_sequence = m_fd->sequence;
-      }
-
-      if (seconds_not_alive >= KEEP_ALIVE_PING_SECONDS)
-      {
-         seconds_not_alive = 0;
-         unsigned char buff[1];
-         if (edgedata_rpc_send_request(m_fd, MSG_TYPE_PING, buff, 0))
-         {
-            INFO_LOG("Send Ping ok\n");
-         }
-         else
-         {
-            INFO_LOG("Send Ping failed\n");
-            if (m_fd->error_connection_cb != NULL)
-            {
-               m_fd->error_connection_cb((void*)m_fd);
-            }
-         }
-      }
+      (void)__atomic_fetch_or(&table->dirty[entry_pos / 64], bit, __ATOMIC_RELEASE);
    }
-   return NULL;
 }
 
-void edgedata_thread_start_keep_alive(EDGEDATA_IPC_FD* fd)
+/* cleared before internal is copied, a change while copying sets it again */
+static bool edgedata_data_table_take_dirty(EDGEDATA_VALUE_TABLE* table, uint32_t entry_pos)
 {
-   if (fd == NULL)
+   uint64_t bit = (uint64_t)1 << (entry_pos % 64);
+   if ((__atomic_load_n(&table->dirty[entry_pos / 64], __ATOMIC_ACQUIRE) & bit) == 0)
    {
-      return;
+      return false;
    }
-   pthread_create(&fd->p_thread_keep_alive, NULL, &thread_rpc_keep_alive, fd);
+   (void)__atomic_fetch_and(&table->dirty[entry_pos / 64], ~bit, __ATOMIC_ACQ_REL);
+   return true;
 }
 
-void* thread_rpc_recv(void* fd)
+/* first entry with this topic */
+static EDGEDATA_VALUES* edgedata_data_table_find_topic(EDGEDATA_VALUE_TABLE* table, const char* topic)
 {
-   uint32_t message_type;
-   uint32_t sequence;
-   uint32_t payload_len;
-   uint8_t  control_flags;
-   unsigned char* payload;
-   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
-
-   INFO_LOG("RECV Thread STARTED\n");
-   while (!m_fd->b_shutdown)
+   if (table->topic_slots.empty())
    {
-      if (!edgedata_rpc_recv(m_fd, &message_type, &sequence, &control_flags, &payload, &payload_len))
-      {
-         break;
-      }
-
-      if (is_request(control_flags))
-      {
-         edgedata_callback_with_reply(m_fd, message_type, sequence, payload, payload_len);
-      }
-      else
+      return NULL;
+   }
+   uint32_t hash = edgedata_data_topic_hash(topic);
+   uint32_t mask = (uint32_t)table->topic_slots.size() - 1;
+   for (uint32_t pos = edgedata_data_table_hash(hash, mask);; pos = (pos + 1) & mask)
+   {
+      uint64_t slot = table->topic_slots[pos];
+      if ((uint32_t)slot == 0)
       {
-         edgedata_callback(m_fd, message_type, sequence, payload, payload_len);
+         return NULL;
       }
-
-      if (is_reply(control_flags))
+      if ((uint32_t)(slot >> 32) == hash)
       {
-         edgedata_rpc_inform_about_response(m_fd, sequence);
+         EDGEDATA_VALUES* values = &table->entries[(uint32_t)slot - 1];
+         if (strncmp(values->external->topic, topic, 100) == 0)
+         {
+            return values;
+         }
       }
    }
+}
 
-   if (m_fd->b_shutdown)
-   {
-      INFO_LOG("Manually shutdown requested\n");
-   }
-   else
+/* handle must not be in the table yet */
+static void edgedata_data_table_insert(EDGEDATA_VALUE_TABLE* table, uint32_t handle, const EDGEDATA_VALUES& values)
+{
+   /* load stays below one half, probe sequences stay short */
+   if ((table->entries.size() + 1) * 2 > table->slots.size())
    {
-      ERROR_LOG("shutdown caused by recv error\n");
-      if (m_fd->error_connection_cb != NULL)
+      table->slots.assign(table->slots.empty() ? 64 : table->slots.size() * 2, 0);
+      table->topic_slots.assign(table->slots.size(), 0);
+      for (uint32_t i = 0; i < table->entries.size(); i++)
       {
-         m_fd->error_connection_cb((void*)m_fd);
+         edgedata_data_table_place(table->slots, table->entries[i].internal->handle, i);
+         edgedata_data_table_place(table->topic_slots, edgedata_data_topic_hash(table->entries[i].internal->topic), i);
       }
    }
-   edgedata_rpc_unlock_wait_for_reply_by_timeout(m_fd);
-   edgedata_ipc_close(m_fd);
-   return NULL;
+   table->entries.push_back(values);
+   table->dirty.resize((table->entries.size() + 63) / 64, 0);
+   edgedata_data_table_place(table->slots, handle, (uint32_t)table->entries.size() - 1);
+   edgedata_data_table_place(table->topic_slots, edgedata_data_topic_hash(values.internal->topic), (uint32_t)table->entries.size() - 1);
 }
 
-void edgedata_thread_start_thread_recv(EDGEDATA_IPC_FD* fd)
+/* ************ ARENA ***************** */
+/* makes room for value_count T_EDGE_DATA and topic_len bytes of topics in the same block */
+static void edgedata_data_arena_reserve(EDGEDATA_ARENA* arena, size_t value_count, size_t topic_len)
 {
-   if (fd == NULL)
+   size_t needed = value_count * sizeof(T_EDGE_DATA) + topic_len;
+   if ((size_t)(arena->p_back - arena->p_front) >= needed)
    {
       return;
    }
-   pthread_create(&fd->p_thread_recv, NULL, &thread_rpc_recv, fd);
+   size_t block_words = (((needed > DISCOVER_ARENA_BLOCK_SIZE) ? needed : DISCOVER_ARENA_BLOCK_SIZE) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+   uint64_t* block = new uint64_t[block_words];
+   arena->blocks.push_back(block);
+   arena->p_front = (unsigned char*)block;
+   arena->p_back = arena->p_front + block_words * sizeof(uint64_t);
 }
 
-/* *************************************************************************************************************** */
+/* internal and external value of a data point lie next to each other */
+static T_EDGE_DATA* edgedata_data_arena_values(EDGEDATA_ARENA* arena, const T_EDGE_DATA* init)
+{
+   edgedata_data_arena_reserve(arena, 2, 0);
+   T_EDGE_DATA* values = (T_EDGE_DATA*)arena->p_front;
+   arena->p_front += 2 * sizeof(T_EDGE_DATA);
+   (void)memcpy(&values[0], init, sizeof(T_EDGE_DATA));
+   (void)memcpy(&values[1], init, sizeof(T_EDGE_DATA));
+   return values;
+}
 
-/* ************************************ */
-/* *********Edge Data  LAYER*********** */
-/* ************************************ */
+/* the topics of a block form one string table */
+static const char* edgedata_data_arena_topic(EDGEDATA_ARENA* arena, const char* topic)
+{
+   size_t len = strlen(topic) + 1;
+   edgedata_data_arena_reserve(arena, 0, len);
+   arena->p_back -= len;
+   (void)memcpy(arena->p_back, topic, len);
+   return (const char*)arena->p_back;
+}
 
-/* edge_data_handle_list grows from behind and the beginning */
-static T_EDGE_DATA_HANDLE edge_data_handle_list[MAX_NUMBER_SUPPORTED_DATAPOINTS + 1];
-static T_EDGE_DATA_LIST edge_data_list = { &edge_data_handle_list[0], 0, &edge_data_handle_list[MAX_NUMBER_SUPPORTED_DATAPOINTS], 0 };
-static pthread_mutex_t edge_data_access_mutex = PTHREAD_MUTEX_INITIALIZER;
+static void edgedata_data_arena_free(EDGEDATA_ARENA* arena)
+{
+   for (std::vector<uint64_t*>::iterator it = arena->blocks.begin(); it != arena->blocks.end(); it++)
+   {
+      delete[] (*it);
+   }
+   arena->blocks.clear();
+   arena->p_front = NULL;
+   arena->p_back = NULL;
+}
+
+/* ************ VALUE SEQLOCK ********* */
+/* internal is written by events and edge_data_sync_write, copied by edge_data_sync_read without lock:
+   a writer makes seq odd, a reader retries until it copied between two equal even counts */
+static void edgedata_data_value_write_begin(EDGEDATA_VALUES* values)
+{
+   uint32_t seq = __atomic_load_n(&values->seq, __ATOMIC_RELAXED);
+   while (((seq & 1) != 0) || (!__atomic_compare_exchange_n(&values->seq, &seq, seq + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
+   {  /* another writer (a write value taken over while its event arrives) */
+      sched_yield();
+      seq = __atomic_load_n(&values->seq, __ATOMIC_RELAXED);
+   }
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void edgedata_data_value_write_end(EDGEDATA_VALUES* values)
+{
+   (void)__atomic_fetch_add(&values->seq, 1, __ATOMIC_RELEASE);
+}
+
+/* value, quality and timestamp of internal, never torn */
+static void edgedata_data_value_read(EDGEDATA_VALUES* values, T_EDGE_DATA* data)
+{
+   T_EDGE_DATA_VALUE value;
+   uint32_t quality;
+   int64_t timestamp64;
+   uint32_t seq;
+   do
+   {
+      seq = __atomic_load_n(&values->seq, __ATOMIC_ACQUIRE);
+      (void)memcpy(&value, &values->internal->value, sizeof(value));
+      quality = values->internal->quality;
+      timestamp64 = values->internal->timestamp64;
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   } while (((seq & 1) != 0) || (seq != __atomic_load_n(&values->seq, __ATOMIC_RELAXED)));
+   (void)memcpy(&data->value, &value, sizeof(value));
+   data->quality = quality;
+   data->timestamp64 = timestamp64;
+}
 
 /* ************ GENERAL *************** */
 static EdgeDataType convertTypeToFB(E_EDGE_DATA_TYPE type, T_EDGE_DATA_VALUE* value, flatbuffers::Offset<Anonymous0>* retval_ano0, FlatBufferBuilder& builder)
@@ -940,20 +3752,20 @@ void edgedata_data_print_state(EDGEDATA_IPC_FD* fd)
 {
    ENTER_ACCESS_DATA();
    ERROR_LOG("edgedata_data_print_state data: (INTERNAL-EXTERNAL)\n");
-   for (map<uint32_t, EDGEDATA_VALUES>::iterator it = fd->read_values.begin(); it != fd->read_values.end(); it++)
+   for (std::vector<EDGEDATA_VALUES>::iterator it = fd->read_values.entries.begin(); it != fd->read_values.entries.end(); it++)
    {
-      T_EDGE_DATA* entry = it->second.internal;
-      T_EDGE_DATA* entry2 = it->second.external;
+      T_EDGE_DATA* entry = it->internal;
+      T_EDGE_DATA* entry2 = it->external;
       ERROR_LOG("READ Topic: %s, handle: %d-%d, quality: %d-%d, type; %d-%d, timestamp: %ld-%ld, value: %d-%d\n",
          entry->topic, entry->handle, entry2->handle,
          entry->quality, entry2->quality,
          entry->type, entry2->type, entry->timestamp64, entry2->timestamp64,
          entry->value.uint32, entry2->value.uint32);
    }
-   for (map<uint32_t, EDGEDATA_VALUES>::iterator it = fd->write_values.begin(); it != fd->write_values.end(); it++)
+   for (std::vector<EDGEDATA_VALUES>::iterator it = fd->write_values.entries.begin(); it != fd->write_values.entries.end(); it++)
    {
-      T_EDGE_DATA* entry = it->second.internal;
-      T_EDGE_DATA* entry2 = it->second.external;
+      T_EDGE_DATA* entry = it->internal;
+      T_EDGE_DATA* entry2 = it->external;
       ERROR_LOG("READ Topic: %s, handle: %d-%d, quality: %d-%d, type; %d-%d, timestamp: %ld-%ld, value: %d-%d\n",
          entry->topic, entry->handle, entry2->handle,
          entry->quality, entry2->quality,
@@ -968,24 +3780,22 @@ void edgedata_data_cleanup(EDGEDATA_IPC_FD** fd)
    ENTER_ACCESS_DATA();
    if (fd != NULL)
    {
-      if (*fd != NULL)
+      EDGEDATA_IPC_FD* p_fd = *fd;
+      /* new readers see no connection, running ones are waited for */
+      __atomic_store_n(fd, NULL, __ATOMIC_SEQ_CST);
+      while (edge_data_readers.load() != 0)
       {
-         //TODO check if memory leak after disconnect!!!!!!!!!
-         for (map<uint32_t, EDGEDATA_VALUES>::iterator it = (*fd)->read_values.begin(); it != (*fd)->read_values.end(); it++)
-         {
-            delete it->second.p_topic;
-            delete it->second.internal;
-            delete it->second.external;
-         }
-         for (map<uint32_t, EDGEDATA_VALUES>::iterator it = (*fd)->write_values.begin(); it != (*fd)->write_values.end(); it++)
-         {
-            delete it->second.p_topic;
-            delete it->second.internal;
-            delete it->second.external;
-         }
-         delete (*fd);
+         sched_yield();
+      }
+      if (p_fd != NULL)
+      {
+         /* values and topics of both tables */
+         edgedata_data_arena_free(&p_fd->discover_arena);
+         delete[] p_fd->p_large_reply;
+         pthread_cond_destroy(&p_fd->window_cond);
+         pthread_cond_destroy(&p_fd->send_lanes_cond);
+         delete p_fd;
       }
-      *fd = NULL;
    }
    LEAVE_ACCESS_DATA();
 }
@@ -993,79 +3803,130 @@ void edgedata_data_cleanup(EDGEDATA_IPC_FD** fd)
 /* ************ Event Data Update ************ */
 void edgedata_data_event_message_info(EDGEDATA_IPC_FD* fd, const edgedata_flatbuffers::EdgeDataInfo* t) /* TODO APPEND HERE WITH MULTIPLE EVENTS */
 {
-   /* Update data */
-
-   ENTER_ACCESS_DATA();
-   map<uint32_t, EDGEDATA_VALUES>::iterator it = fd->read_values.find(t->handle());
-   if (it != fd->read_values.end())
+   bool b_changed = false;
+   int32_t event_fd;
+   uint32_t callbacks_len = 0;
+   cb_edge_data_subscribe cb[2];
+   T_EDGE_DATA copy_data[2];
+   /* Update data (no lock, the tables change only by discover on this thread, readers use the seqlock). */
+   /* t points into the receive buffer, both tables are updated before a callback may send or receive.  */
+
+   event_fd = __atomic_load_n(&edge_data_event_fd, __ATOMIC_ACQUIRE);
+   int32_t entry_pos = edgedata_data_table_find_pos(&fd->read_values, t->handle());
+   EDGEDATA_VALUES* values = (entry_pos < 0) ? NULL : &fd->read_values.entries[entry_pos];
+   if (values != NULL)
    {
+      b_changed = true;
       //T_EDGE_DATA_VALUE value;
       const Anonymous0* ano0 = t->value();
-      it->second.internal->type = convertTypeFromFB(t->type(), ano0, &it->second.internal->value);
-      it->second.internal->quality = t->quality();
-      it->second.internal->timestamp64 = t->timestamp64();
-      // edgedata_data_print_value (&it->second.internal->value, it->second.internal->type, str_value, sizeof (str_value) - 1);
-      // INFO_LOG ("Topic %s updated with value: %s\n", it->second.internal->topic, str_value);
-   }
-   LEAVE_ACCESS_DATA();
-
-   /* Trigger Callback if available */
-   it = fd->read_values.find(t->handle());
-   if (it != fd->read_values.end())
-   {
-      if (it->second.cb != NULL)
+      edgedata_data_value_write_begin(values);
+      values->internal->type = convertTypeFromFB(t->type(), ano0, &values->internal->value);
+      values->internal->quality = t->quality();
+      values->internal->timestamp64 = t->timestamp64();
+      // edgedata_data_print_value (&values->internal->value, values->internal->type, str_value, sizeof (str_value) - 1);
+      // INFO_LOG ("Topic %s updated with value: %s\n", values->internal->topic, str_value);
+      (void)memcpy(&copy_data[callbacks_len], values->internal, sizeof(T_EDGE_DATA));
+      edgedata_data_value_write_end(values);
+      edgedata_data_table_set_dirty(&fd->read_values, (uint32_t)entry_pos);
+      cb[callbacks_len] = __atomic_load_n(&values->cb, __ATOMIC_ACQUIRE);
+      if (cb[callbacks_len] != NULL)
       {
-         T_EDGE_DATA copy_data;
-         (void)memcpy(&copy_data, it->second.internal, sizeof(T_EDGE_DATA));
-         it->second.cb(&copy_data);
+         callbacks_len++;
       }
    }
+
    /* Update WRITE data */
-   ENTER_ACCESS_DATA();
-   it = fd->write_values.find(t->handle());
-   if (it != fd->write_values.end())
+   values = edgedata_data_table_find(&fd->write_values, t->handle());
+   if (values != NULL)
    {
+      b_changed = true;
       //T_EDGE_DATA_VALUE value;
       const Anonymous0* ano0 = t->value();
-      it->second.internal->type = convertTypeFromFB(t->type(), ano0, &it->second.internal->value);
-      it->second.internal->quality = t->quality();
-      it->second.internal->timestamp64 = t->timestamp64();
+      edgedata_data_value_write_begin(values);
+      values->internal->type = convertTypeFromFB(t->type(), ano0, &values->internal->value);
+      values->internal->quality = t->quality();
+      values->internal->timestamp64 = t->timestamp64();
+      (void)memcpy(&copy_data[callbacks_len], values->internal, sizeof(T_EDGE_DATA));
+      edgedata_data_value_write_end(values);
+      cb[callbacks_len] = __atomic_load_n(&values->cb, __ATOMIC_ACQUIRE);
+      if (cb[callbacks_len] != NULL)
+      {
+         callbacks_len++;
+      }
    }
-   LEAVE_ACCESS_DATA();
 
-   /* Trigger Callback if available */
-   it = fd->write_values.find(t->handle());
-   if (it != fd->write_values.end())
+   /* Trigger Callbacks */
+   for (uint32_t i = 0; i < callbacks_len; i++)
    {
-      if (it->second.cb != NULL)
+      if (fd->b_defer_callbacks)
+      {  /* see edgedata_rpc_run_deferred_callbacks */
+         EDGEDATA_DEFERRED_CALLBACK deferred;
+         deferred.event_cb = cb[i];
+         deferred.pending = NULL;
+         (void)memcpy(&deferred.event, &copy_data[i], sizeof(T_EDGE_DATA));
+         fd->deferred_callbacks.push_back(deferred);
+      }
+      else
       {
-         T_EDGE_DATA copy_data;
-         (void)memcpy(&copy_data, it->second.internal, sizeof(T_EDGE_DATA));
-         it->second.cb(&copy_data);
+         cb[i](&copy_data[i]);
       }
    }
+   if ((b_changed) && (event_fd >= 0))
+   {  /* wakes the application, the counter is reset by its read */
+      uint64_t counter = 1;
+      (void)write(event_fd, &counter, sizeof(counter));
+   }
 }
 
 /* ************ Discover Data Update ********** */
 static void edgedata_data_clean_discover_info()
 {
-   (void)memset(edge_data_handle_list, 0, sizeof(edge_data_handle_list));
-   edge_data_list.read_handle_list = &edge_data_handle_list[0];
-   edge_data_list.write_handle_list = &edge_data_handle_list[MAX_NUMBER_SUPPORTED_DATAPOINTS];
+   edge_data_read_handles.clear();
+   edge_data_write_handles.clear();
+   __atomic_store_n(&edge_data_list.read_handle_list, edge_data_read_handles.data(), __ATOMIC_RELEASE);
+   edge_data_list.write_handle_list = edge_data_write_handles.data();
    edge_data_list.read_handle_list_len = 0;
    edge_data_list.write_handle_list_len = 0;
 }
 
+/* caller holds ACCESS_DATA: handles of the table in discover order, a larger vector replaces (and retires) a too small one */
+static void edgedata_data_fill_handles(std::vector<T_EDGE_DATA_HANDLE>& handles, EDGEDATA_VALUE_TABLE* table)
+{
+   if (table->entries.size() > handles.capacity())
+   {  /* doubled at least: all retired vectors together are smaller than the current one */
+      std::vector<T_EDGE_DATA_HANDLE> larger;
+      larger.reserve((table->entries.size() > (2 * handles.capacity())) ? table->entries.size() : (2 * handles.capacity()));
+      edge_data_retired_handles.push_back(std::vector<T_EDGE_DATA_HANDLE>());
+      edge_data_retired_handles.back().swap(handles);
+      handles.swap(larger);
+   }
+   handles.resize(table->entries.size());
+   for (uint32_t entry_pos = 0; entry_pos < handles.size(); entry_pos++)
+   {
+      handles[entry_pos] = table->entries[entry_pos].internal->handle;
+   }
+}
+
+/* caller holds ACCESS_DATA: handle lists of edge_data_discover in discover order, once discover completed */
+static void edgedata_data_publish_discover_info(EDGEDATA_IPC_FD* fd)
+{
+   edgedata_data_fill_handles(edge_data_read_handles, &fd->read_values);
+   edgedata_data_fill_handles(edge_data_write_handles, &fd->write_values);
+   edge_data_list.read_handle_list_len = (uint32_t)edge_data_read_handles.size();
+   edge_data_list.write_handle_list_len = (uint32_t)edge_data_write_handles.size();
+   edge_data_list.write_handle_list = edge_data_write_handles.data();
+   /* compared by edge_data_sync_read without lock */
+   __atomic_store_n(&edge_data_list.read_handle_list, edge_data_read_handles.data(), __ATOMIC_RELEASE);
+}
+
 void edgedata_data_update_discover_info(EDGEDATA_IPC_FD* fd, const flatbuffers::VectorIterator<flatbuffers::Offset<edgedata_flatbuffers::EdgeDataInfo>, const edgedata_flatbuffers::EdgeDataInfo*> t)
 {
    uint32_t source = t->source();
 
    DEBUG_FB_LOG("Add to discover list\n");
-   map<uint32_t, EDGEDATA_VALUES>::iterator it;
    if ((source & EDGE_SOURCE_FLAG_READ) != 0)
    {
-      it = fd->read_values.find(t->handle());
-      if (it != fd->read_values.end())
+      if (edgedata_data_table_find(&fd->read_values, t->handle()) != NULL)
       {
          ERROR_LOG("Entry already exists in discover read list\n");
          return;
@@ -1073,25 +3934,18 @@ void edgedata_data_update_discover_info(EDGEDATA_IPC_FD* fd, const flatbuffers::
    }
    else
    {
-      it = fd->write_values.find(t->handle());
-      if (it != fd->write_values.end())
+      if (edgedata_data_table_find(&fd->write_values, t->handle()) != NULL)
       {
          ERROR_LOG("Entry already exists in discover write list\n");
          return;
       }
    }
 
-   if ((edge_data_list.read_handle_list_len + edge_data_list.write_handle_list_len) >= MAX_NUMBER_SUPPORTED_DATAPOINTS)
-   {
-      ERROR_LOG("Too many discover objects!\n");
-      return;
-   }
    /* add it (its new)       */
    EDGEDATA_VALUES values;
    T_EDGE_DATA value_info;
-   values.p_topic = new std::string();
-   values.p_topic->assign(t->topic()->c_str());
-   value_info.topic = values.p_topic->c_str();
+   T_EDGE_DATA* p_values;
+   value_info.topic = edgedata_data_arena_topic(&fd->discover_arena, t->topic()->c_str());
    value_info.handle = t->handle();
    const Anonymous0* ano0 = t->value();
    value_info.type = convertTypeFromFB(t->type(), ano0, &value_info.value);
@@ -1100,22 +3954,21 @@ void edgedata_data_update_discover_info(EDGEDATA_IPC_FD* fd, const flatbuffers::
 
    if ((source & EDGE_SOURCE_FLAG_READ) != 0)
    {
-      values.internal = new T_EDGE_DATA(value_info);
-      values.external = new T_EDGE_DATA(value_info);
+      p_values = edgedata_data_arena_values(&fd->discover_arena, &value_info);
+      values.internal = &p_values[0];
+      values.external = &p_values[1];
       values.cb = NULL;
-      fd->read_values.insert(std::make_pair(value_info.handle, values));
-      edge_data_list.read_handle_list[edge_data_list.read_handle_list_len] = value_info.handle;
-      edge_data_list.read_handle_list_len++;
+      values.seq = 0;
+      edgedata_data_table_insert(&fd->read_values, value_info.handle, values);
    }
    if ((source & EDGE_SOURCE_FLAG_WRITE) != 0)
    {
-      values.internal = new T_EDGE_DATA(value_info);
-      values.external = new T_EDGE_DATA(value_info);
+      p_values = edgedata_data_arena_values(&fd->discover_arena, &value_info);
+      values.internal = &p_values[0];
+      values.external = &p_values[1];
       values.cb = NULL;
-      fd->write_values.insert(std::make_pair(value_info.handle, values));
-      edge_data_list.write_handle_list--;
-      edge_data_list.write_handle_list[0] = value_info.handle;  /* the write list grows in opposite direction !! */
-      edge_data_list.write_handle_list_len++;
+      values.seq = 0;
+      edgedata_data_table_insert(&fd->write_values, value_info.handle, values);
    }
 }
 
@@ -1124,33 +3977,29 @@ bool edgedata_data_discover_add(EDGEDATA_IPC_FD* fd, const char* topic, uint32_t
 {
    EDGEDATA_VALUES values;
    T_EDGE_DATA internal;
+   T_EDGE_DATA* p_values;
 
-   if (fd->read_values.size() + fd->write_values.size() >= MAX_NUMBER_SUPPORTED_DATAPOINTS)
-   {
-      return false;
-   }
-
-   values.p_topic = new string();
-   values.p_topic->assign(topic);
-   internal.topic = values.p_topic->c_str();
+   internal.topic = edgedata_data_arena_topic(&fd->discover_arena, topic);
    internal.handle = handle;
    internal.type = type;
    internal.quality = quality;
    (void)memset(&internal.value, 0, sizeof(T_EDGE_DATA_VALUE));
    memcpy(&internal.value, init_value, sizeof(T_EDGE_DATA_VALUE));
    internal.timestamp64 = init_timestamp;
-   values.internal = new T_EDGE_DATA(internal);
-   values.external = new T_EDGE_DATA(internal);
+   p_values = edgedata_data_arena_values(&fd->discover_arena, &internal);
+   values.internal = &p_values[0];
+   values.external = &p_values[1];
    values.cb = cb;
+   values.seq = 0;
    if (source == EDGE_SOURCE_FLAG_READ)
    {
-      fd->read_values.insert(std::make_pair(handle, values));
-      fd->it_read_discover_info = fd->read_values.begin();
+      edgedata_data_table_insert(&fd->read_values, handle, values);
+      fd->read_discover_pos = 0;
    }
    else
    {
-      fd->write_values.insert(std::make_pair(handle, values));
-      fd->it_write_discover_info = fd->write_values.begin();
+      edgedata_data_table_insert(&fd->write_values, handle, values);
+      fd->write_discover_pos = 0;
    }
    return true;
 }
@@ -1165,15 +4014,17 @@ bool edgedata_data_discover_add(EDGEDATA_IPC_FD* fd, const char* topic, uint32_t
 uint32_t edgedata_flatbuffers_discover_serialize(EDGEDATA_IPC_FD* fd, unsigned char* p_payload, uint32_t max_payload_len)
 {
    uint32_t serialized_datapoints = 0;
+   /* with fragmentation the whole discover list fits in a few messages */
+   uint32_t max_datapoints = (max_payload_len > MAX_PAYLOAD_SIZE) ? MAX_DISCOVERED_DATAPOINTS_PER_LARGE_MSG : MAX_DISCOVERED_DATAPOINTS_PER_MSG;
 
    DEBUG_FB_LOG("Enter edgedata_flatbuffers_discover_serialize\n");
 
    FlatBufferBuilder builder(MSG_MAX_FULL_SIZE);
    std::vector<flatbuffers::Offset<EdgeDataInfo>> discover_list;
    /* serialize read topics */
-   for (; (fd->it_read_discover_info != fd->read_values.end() && serialized_datapoints < MAX_DISCOVERED_DATAPOINTS_PER_MSG); fd->it_read_discover_info++)
+   for (; (fd->read_discover_pos < fd->read_values.entries.size() && serialized_datapoints < max_datapoints); fd->read_discover_pos++)
    {
-      T_EDGE_DATA* entry = fd->it_read_discover_info->second.internal;
+      T_EDGE_DATA* entry = fd->read_values.entries[fd->read_discover_pos].internal;
       auto topic = builder.CreateString(entry->topic);
       flatbuffers::Offset<Anonymous0> ano0;
       EdgeDataType type = convertTypeToFB(entry->type, &entry->value, &ano0, builder);
@@ -1182,9 +4033,9 @@ uint32_t edgedata_flatbuffers_discover_serialize(EDGEDATA_IPC_FD* fd, unsigned c
       serialized_datapoints++;
    }
    /* serialize write topics */
-   for (; (fd->it_write_discover_info != fd->write_values.end() && serialized_datapoints < MAX_DISCOVERED_DATAPOINTS_PER_MSG); fd->it_write_discover_info++)
+   for (; (fd->write_discover_pos < fd->write_values.entries.size() && serialized_datapoints < max_datapoints); fd->write_discover_pos++)
    {
-      T_EDGE_DATA* entry = fd->it_write_discover_info->second.internal;
+      T_EDGE_DATA* entry = fd->write_values.entries[fd->write_discover_pos].internal;
       auto topic = builder.CreateString(entry->topic);
       flatbuffers::Offset<Anonymous0> ano0;
       EdgeDataType type = convertTypeToFB(entry->type, &entry->value, &ano0, builder);
@@ -1205,6 +4056,7 @@ uint32_t edgedata_flatbuffers_discover_serialize(EDGEDATA_IPC_FD* fd, unsigned c
    if (builder.GetSize() < max_payload_len)
    {
       memcpy(p_payload, builder.GetBufferPointer(), builder.GetSize());
+      fd->statistics.bytes_copied_send += builder.GetSize();
       DEBUG_FB_LOG("discover message serialize finish\n");
       return builder.GetSize();
    }
@@ -1234,6 +4086,11 @@ void edgedata_flatbuffers_discover_message_parse(void* fd, unsigned char* p_payl
       ERROR_LOG("edgedata_flatbuffers_discover_message_parse parse error\n");
       return;
    }
+   if (m_fd->b_discovered.load(std::memory_order_acquire))
+   {  /* the tables are read without lock from now on */
+      ERROR_LOG("edgedata_flatbuffers_discover_message_parse discover already completed\n");
+      return;
+   }
    const flatbuffers::Vector<flatbuffers::Offset<EdgeDataInfo>>* p_discover_list = discover_reply->DiscoverList();
    if (p_discover_list == NULL)
    {
@@ -1241,6 +4098,17 @@ void edgedata_flatbuffers_discover_message_parse(void* fd, unsigned char* p_payl
       return;
    }
 
+   /* one arena block for all data points of the message */
+   size_t value_count = 0;
+   size_t topic_len = 0;
+   for (auto t = p_discover_list->begin(); t != p_discover_list->end(); t++)
+   {
+      value_count += ((t->source() & EDGE_SOURCE_FLAG_READ) != 0) ? 2 : 0;
+      value_count += ((t->source() & EDGE_SOURCE_FLAG_WRITE) != 0) ? 2 : 0;
+      topic_len += t->topic()->size() + 1;
+   }
+   edgedata_data_arena_reserve(&m_fd->discover_arena, value_count, topic_len);
+
    /* iterate over discover list */
    for (auto t = p_discover_list->begin(); t != p_discover_list->end(); t++)
    {
@@ -1266,9 +4134,8 @@ uint32_t edgedata_flatbuffers_discover_with_reply(void* fd, unsigned char* paylo
 
 /* ************ EVENT MSG************** */
 /* Send a single event */
-bool edgedata_flatbuffers_edge_event_send(void* fd, uint32_t handle, E_EDGE_DATA_TYPE type, uint32_t quality, T_EDGE_DATA_VALUE* value, int64_t timestamp64)
+static void edgedata_flatbuffers_edge_event_build(FlatBufferBuilder& builder, uint32_t handle, E_EDGE_DATA_TYPE type, uint32_t quality, T_EDGE_DATA_VALUE* value, int64_t timestamp64)
 {
-   FlatBufferBuilder builder(MSG_MAX_FULL_SIZE);
    flatbuffers::Offset<Anonymous0> ano0;
    EdgeDataType type_fb = convertTypeToFB(type, value, &ano0, builder);
    auto new_event = CreateEdgeDataInfo(builder, 0, handle, type_fb, EDGE_SOURCE_FLAG_READ, quality, timestamp64, ano0);
@@ -1276,8 +4143,30 @@ bool edgedata_flatbuffers_edge_event_send(void* fd, uint32_t handle, E_EDGE_DATA
    EdgeDataEventMessageBuilder event_message_builder(builder);
    event_message_builder.add_event(new_event);
    builder.Finish(event_message_builder.Finish());
-   EDGEDATA_IPC_FD* m_fd = (EDGEDATA_IPC_FD*)fd;
-   return edgedata_rpc_send_request(m_fd, MSG_TYPE_UPDATE_DATA, builder.GetBufferPointer(), builder.GetSize());
+}
+
+/* sends the event without waiting for the reply (see edgedata_rpc_send_request_begin) */
+bool edgedata_flatbuffers_edge_event_send_begin(void* fd, uint32_t handle, E_EDGE_DATA_TYPE type, uint32_t quality, T_EDGE_DATA_VALUE* value, int64_t timestamp64, EDGEDATA_RPC_PENDING* pending)
+{
+   FlatBufferBuilder builder(MSG_MAX_FULL_SIZE);
+   edgedata_flatbuffers_edge_event_build(builder, handle, type, quality, value, timestamp64);
+   return edgedata_rpc_send_request_begin((EDGEDATA_IPC_FD*)fd, MSG_TYPE_UPDATE_DATA, builder.GetBufferPointer(), builder.GetSize(), pending);
+}
+
+/* sends the event, cb is called with the reply (see edgedata_rpc_send_request_async) */
+bool edgedata_flatbuffers_edge_event_send_async(void* fd, uint32_t handle, E_EDGE_DATA_TYPE type, uint32_t quality, T_EDGE_DATA_VALUE* value, int64_t timestamp64, fct_rpc_completion cb, void* context)
+{
+   FlatBufferBuilder builder(MSG_MAX_FULL_SIZE);
+   edgedata_flatbuffers_edge_event_build(builder, handle, type, quality, value, timestamp64);
+   return edgedata_rpc_send_request_async((EDGEDATA_IPC_FD*)fd, MSG_TYPE_UPDATE_DATA, builder.GetBufferPointer(), builder.GetSize(), cb, context);
+}
+
+/* sends the event as part of the event stream (see edgedata_rpc_send_stream) */
+bool edgedata_flatbuffers_edge_event_send(void* fd, uint32_t handle, E_EDGE_DATA_TYPE type, uint32_t quality, T_EDGE_DATA_VALUE* value, int64_t timestamp64)
+{
+   FlatBufferBuilder builder(MSG_MAX_FULL_SIZE);
+   edgedata_flatbuffers_edge_event_build(builder, handle, type, quality, value, timestamp64);
+   return edgedata_rpc_send_stream((EDGEDATA_IPC_FD*)fd, MSG_TYPE_UPDATE_DATA, builder.GetBufferPointer(), builder.GetSize());
 }
 
 /* Client Callback to process incomming events */
@@ -1313,16 +4202,47 @@ uint32_t edgedata_flatbuffers_edge_event_receive(void* fd, unsigned char* payloa
 /* static */ EDGEDATA_IPC_FD* edge_data_fd = NULL;
 static pthread_mutex_t edge_app_access_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+static cb_edge_data_credit edge_data_credit_cb = NULL;
+static void* edge_data_credit_context = NULL;
+
+/* caller holds ACCESS_APP: the connection whose deferred callbacks the API call runs after ACCESS_APP (process by caller only) */
+static EDGEDATA_IPC_FD* edgedata_app_caller_fd()
+{
+   return ((edge_data_fd != NULL) && (edge_data_fd->b_recv_by_caller)) ? edge_data_fd : NULL;
+}
+
+/* receive thread: the backend accepts writes again after E_EDGE_DATA_RETVAL_WOULD_BLOCK */
+static void edgedata_app_credit_available(void* fd)
+{
+   cb_edge_data_credit cb = edge_data_credit_cb;
+   if (cb != NULL)
+   {
+      cb(edge_data_credit_context);
+   }
+}
+
 E_EDGE_DATA_RETVAL edge_data_connect_internal(bool auto_retry)
 {
    uint32_t number_of_discoverd_elements = 0;
    E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
+   EDGEDATA_IPC_FD* caller_fd;
+   if ((edge_data_fd != NULL) && (edge_data_fd->b_recv_busy))
+   {  /* called by a callback of edge_data_process */
+      return E_EDGE_DATA_RETVAL_WOULD_BLOCK;
+   }
    if (edge_data_fd != NULL)
    {
       edge_data_disconnect();
    }
    ENTER_ACCESS_APP();
-   edge_data_fd = edgedata_ipc_unix_client_connect("/edgedata/edgedata");
+   if (edgedata_ipc_loopback_server != NULL)
+   {  /* in-process backend (tests, benchmarks) */
+      edge_data_fd = edgedata_ipc_loopback_connect(edgedata_ipc_loopback_server);
+   }
+   else
+   {
+      edge_data_fd = edgedata_ipc_unix_client_connect("/edgedata/edgedata");
+   }
    //edge_data_fd = edgedata_ipc_fifo_client_connect("edge_data.fifo");  
    if (edge_data_fd == NULL)
    {
@@ -1331,31 +4251,42 @@ E_EDGE_DATA_RETVAL edge_data_connect_internal(bool auto_retry)
    }
    else
    {
+      if (!edgedata_rpc_capabilities_client_exchange(edge_data_fd))
+      {
+         INFO_LOG("Capabilities exchange failed, send single frame messages only\n");
+      }
+      if ((edge_data_fd->config.b_shared_memory) && (!edgedata_ipc_shm_client_setup(edge_data_fd)))
+      {
+         INFO_LOG("Shared memory not supported by backend, use unix socket\n");
+      }
+      if ((edge_data_fd->config.b_io_uring) && (edge_data_fd->shm == NULL) && (!edgedata_ipc_uring_activate(edge_data_fd)))
+      {
+         INFO_LOG("io_uring not available, use read()\n");
+      }
+
       ENTER_ACCESS_DATA();
-      memset(edge_data_handle_list, 0, sizeof(edge_data_handle_list));
-      edge_data_list.read_handle_list = &edge_data_handle_list[0];
-      edge_data_list.write_handle_list = &edge_data_handle_list[MAX_NUMBER_SUPPORTED_DATAPOINTS];
-      edge_data_list.read_handle_list_len = 0;
-      edge_data_list.write_handle_list_len = 0;
+      edgedata_data_clean_discover_info();
       LEAVE_ACCESS_DATA();
 
       /* Callback used to process reply from inital discover request */
       (void)edgedata_callback_register(edge_data_fd, MSG_TYPE_DISCOVER, edgedata_flatbuffers_discover_message_parse);
       (void)edgedata_callback_with_reply_register(edge_data_fd, MSG_TYPE_UPDATE_DATA, edgedata_flatbuffers_edge_event_receive);
       (void)edgedata_callback_register(edge_data_fd, MSG_TYPE_UPDATE_DATA, edgedata_rpc_dummy_ack);
-      /* start recv thread */
-      edgedata_thread_start_thread_recv(edge_data_fd);
-      /* start keep alive thread */
-      edgedata_thread_start_keep_alive(edge_data_fd);
+      edge_data_fd->credit_cb = edgedata_app_credit_available;
+      /* start recv thread (keep alive included), none if the application calls edge_data_process */
+      if (!edgedata_thread_start_thread_recv(edge_data_fd))
+      {
+         ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
+      }
 
       unsigned char tmp_write[1];
       /* request discover info (as long as response is empty) */
 
       INFO_LOG("SEND INITIAL DISCOVER REQUEST\n");
-      do
+      while (ret == E_EDGE_DATA_RETVAL_OK)
       {
          /* save actual of read and write value position */
-         number_of_discoverd_elements = edge_data_fd->read_values.size() + edge_data_fd->write_values.size();
+         number_of_discoverd_elements = edge_data_fd->read_values.entries.size() + edge_data_fd->write_values.entries.size();
          if (edgedata_rpc_send_request(edge_data_fd, MSG_TYPE_DISCOVER, tmp_write, 0))
          {
             INFO_LOG("SEND DISCOVER REQUEST (SubMessage) finished\n");
@@ -1367,11 +4298,28 @@ E_EDGE_DATA_RETVAL edge_data_connect_internal(bool auto_retry)
             break;
          }
          /* while no changes detected */
-      } while (number_of_discoverd_elements != (edge_data_fd->read_values.size() + edge_data_fd->write_values.size()));
+         if (number_of_discoverd_elements == (edge_data_fd->read_values.entries.size() + edge_data_fd->write_values.entries.size()))
+         {
+            break;
+         }
+      }
+      if (ret == E_EDGE_DATA_RETVAL_OK)
+      {
+         ENTER_ACCESS_DATA();
+         edgedata_data_publish_discover_info(edge_data_fd);
+         /* from now on the tables do not change, edge_data_sync_read uses them */
+         edge_data_fd->b_discovered.store(true, std::memory_order_release);
+         LEAVE_ACCESS_DATA();
+      }
    }
    /* reorder discover list by topic */
 
+   caller_fd = edgedata_app_caller_fd();
    LEAVE_ACCESS_APP();
+   if (caller_fd != NULL)
+   {
+      edgedata_rpc_run_deferred_callbacks(caller_fd);
+   }
    /* error->clean up */
    if (ret != E_EDGE_DATA_RETVAL_OK)
    {
@@ -1390,17 +4338,22 @@ E_EDGE_DATA_RETVAL edge_data_connect_internal(bool auto_retry)
 
 E_EDGE_DATA_RETVAL edge_data_disconnect()
 {
+   EDGEDATA_IPC_FD* fd;
    ENTER_ACCESS_APP();
-   if (edge_data_fd != NULL)
-   {
-      INFO_LOG("edge_data_disconnect\n");
-      edgedata_ipc_disconnect(&edge_data_fd);
-   }
+   fd = edge_data_fd;
    ENTER_ACCESS_DATA();
+   /* API calls see no connection from now on */
+   __atomic_store_n(&edge_data_fd, NULL, __ATOMIC_SEQ_CST);
    edgedata_data_clean_discover_info();
    LEAVE_ACCESS_DATA();
    LEAVE_ACCESS_APP();
-   sleep(1);
+   /* Without ACCESS_APP: while the receive thread is joined it fails the outstanding writes, */
+   /* their callbacks (and any other one still running) may call the API.                    */
+   if (fd != NULL)
+   {
+      INFO_LOG("edge_data_disconnect\n");
+      edgedata_ipc_disconnect(&fd);
+   }
    return E_EDGE_DATA_RETVAL_OK;
 }
 
@@ -1413,7 +4366,7 @@ const T_EDGE_DATA_LIST* edge_data_discover()
 {
    T_EDGE_DATA_LIST* ret = NULL;
    ENTER_ACCESS_DATA();
-   if (edge_data_fd != NULL)
+   if ((edge_data_fd != NULL) && (edge_data_fd->b_discovered))
    {
       ret = &edge_data_list;
    }
@@ -1426,16 +4379,12 @@ T_EDGE_DATA_HANDLE edge_data_get_readable_handle(const char* topic)
 {
    T_EDGE_DATA_HANDLE ret = 0;
    ENTER_ACCESS_DATA();
-   if (edge_data_fd != NULL)
+   if ((edge_data_fd != NULL) && (edge_data_fd->b_discovered))
    {
-      for (map<uint32_t, EDGEDATA_VALUES>::iterator it = edge_data_fd->read_values.begin(); it != edge_data_fd->read_values.end(); it++)
+      EDGEDATA_VALUES* values = edgedata_data_table_find_topic(&edge_data_fd->read_values, topic);
+      if (values != NULL)
       {
-         T_EDGE_DATA* entry = it->second.external;
-         if (strncmp(entry->topic, topic, 100) == 0)
-         {
-            ret = it->second.external->handle;
-            break;
-         }
+         ret = values->external->handle;
       }
    }
    LEAVE_ACCESS_DATA();
@@ -1446,16 +4395,12 @@ T_EDGE_DATA_HANDLE edge_data_get_writeable_handle(const char* topic)
 {
    T_EDGE_DATA_HANDLE ret = 0;
    ENTER_ACCESS_DATA();
-   if (edge_data_fd != NULL)
+   if ((edge_data_fd != NULL) && (edge_data_fd->b_discovered))
    {
-      for (map<uint32_t, EDGEDATA_VALUES>::iterator it = edge_data_fd->write_values.begin(); it != edge_data_fd->write_values.end(); it++)
+      EDGEDATA_VALUES* values = edgedata_data_table_find_topic(&edge_data_fd->write_values, topic);
+      if (values != NULL)
       {
-         T_EDGE_DATA* entry = it->second.external;
-         if (strncmp(entry->topic, topic, 100) == 0)
-         {
-            ret = it->second.external->handle;
-            break;
-         }
+         ret = values->external->handle;
       }
    }
    LEAVE_ACCESS_DATA();
@@ -1466,27 +4411,17 @@ T_EDGE_DATA* edge_data_get_data(T_EDGE_DATA_HANDLE handle)
 {
    T_EDGE_DATA* ret = NULL;
    ENTER_ACCESS_DATA();
-   if (edge_data_fd != NULL)
+   if ((edge_data_fd != NULL) && (edge_data_fd->b_discovered))
    {
-      map<uint32_t, EDGEDATA_VALUES>::iterator it = edge_data_fd->read_values.find(handle);
-      /* found as read handle? */
-      if (it != edge_data_fd->read_values.end()) {
-         T_EDGE_DATA* entry = it->second.external;
-         if (entry->handle == handle)
-         {
-            ret = it->second.external;
-            LEAVE_ACCESS_DATA();
-            return ret;
-         }
+      EDGEDATA_VALUES* values = edgedata_data_table_find(&edge_data_fd->read_values, handle);
+      /* not a read handle, a write handle? */
+      if (values == NULL)
+      {
+         values = edgedata_data_table_find(&edge_data_fd->write_values, handle);
       }
-      it = edge_data_fd->write_values.find(handle);
-      /* found as write handle? */
-      if (it != edge_data_fd->write_values.end()) {
-         T_EDGE_DATA* entry = it->second.external;
-         if (entry->handle == handle)
-         {
-            ret = it->second.external;
-         }
+      if (values != NULL)
+      {
+         ret = values->external;
       }
    }
    LEAVE_ACCESS_DATA();
@@ -1494,56 +4429,146 @@ T_EDGE_DATA* edge_data_get_data(T_EDGE_DATA_HANDLE handle)
 }
 
 
-E_EDGE_DATA_RETVAL edge_data_sync_read(T_EDGE_DATA_HANDLE* read_handle_list, uint32_t read_handle_list_len)
+/* takes over all values of the list, or only the changed ones if changed_handle_list is given
+   (dirty bits are cleared only by the latter, they mean changed since the last edge_data_sync_read_changed) */
+static E_EDGE_DATA_RETVAL edgedata_app_sync_read(T_EDGE_DATA_HANDLE* read_handle_list, uint32_t read_handle_list_len, T_EDGE_DATA_HANDLE* changed_handle_list, uint32_t* changed_handle_list_len)
 {
    E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
-   ENTER_ACCESS_DATA();
+   /* no lock: announced as reader the connection is not freed, values are copied by seqlock */
+   edge_data_readers.fetch_add(1);
+   EDGEDATA_IPC_FD* fd = __atomic_load_n(&edge_data_fd, __ATOMIC_SEQ_CST);
    if (read_handle_list == NULL)
    {
       ret = E_EDGE_DATA_RETVAL_NOK;
    }
-   else if (edge_data_fd == NULL)
+   else if (fd == NULL)
    {
       ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
    }
-   else if (!edge_data_fd->b_connected)
-   {
+   else if ((!fd->b_connected) || (!fd->b_discovered.load(std::memory_order_acquire)))
+   {  /* b_discovered: edge_data_connect still fills the tables */
       ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
    }
+   else if ((read_handle_list == __atomic_load_n(&edge_data_list.read_handle_list, __ATOMIC_ACQUIRE)) && (read_handle_list_len <= fd->read_values.entries.size()))
+   {  /* read list of edge_data_discover: list position is entry position, no lookup */
+      if (changed_handle_list == NULL)
+      {
+         for (uint32_t entry_pos = 0; entry_pos < read_handle_list_len; entry_pos++)
+         {
+            EDGEDATA_VALUES* values = &fd->read_values.entries[entry_pos];
+            edgedata_data_value_read(values, values->external);
+         }
+      }
+      else
+      {  /* only dirty bits are visited */
+         for (uint32_t word = 0; (word * 64) < read_handle_list_len; word++)
+         {
+            uint64_t bits = __atomic_load_n(&fd->read_values.dirty[word], __ATOMIC_ACQUIRE);
+            while (bits != 0)
+            {
+               uint32_t entry_pos = (word * 64) + (uint32_t)__builtin_ctzll(bits);
+               bits &= bits - 1;
+               if ((entry_pos < read_handle_list_len) && (edgedata_data_table_take_dirty(&fd->read_values, entry_pos)))
+               {
+                  EDGEDATA_VALUES* values = &fd->read_values.entries[entry_pos];
+                  edgedata_data_value_read(values, values->external);
+                  changed_handle_list[*changed_handle_list_len] = read_handle_list[entry_pos];
+                  (*changed_handle_list_len)++;
+               }
+            }
+         }
+      }
+   }
    else
    {
       for (uint32_t pos = 0; pos < read_handle_list_len; pos++)
       {
-         map<uint32_t, EDGEDATA_VALUES>::iterator it = edge_data_fd->read_values.find(read_handle_list[pos]);
+         int32_t entry_pos = edgedata_data_table_find_pos(&fd->read_values, read_handle_list[pos]);
          /* found handle? */
-         if (it != edge_data_fd->read_values.end())
-         {   /* yes, update value */
-            (void)memcpy(&it->second.external->value, &it->second.internal->value, sizeof(it->second.internal->value));
-            it->second.external->quality = it->second.internal->quality;
-            it->second.external->timestamp64 = it->second.internal->timestamp64;
-         }
-         else
+         if (entry_pos < 0)
          {
             ERROR_LOG("edge_data_sync_read Invalid Handle\n");
             ret = E_EDGE_DATA_RETVAL_UNKNOWN_HANDLE;
             break;
          }
+         if (changed_handle_list == NULL)
+         {   /* update value */
+            EDGEDATA_VALUES* values = &fd->read_values.entries[entry_pos];
+            edgedata_data_value_read(values, values->external);
+         }
+         else if (edgedata_data_table_take_dirty(&fd->read_values, (uint32_t)entry_pos))
+         {   /* update changed value only */
+            EDGEDATA_VALUES* values = &fd->read_values.entries[entry_pos];
+            edgedata_data_value_read(values, values->external);
+            changed_handle_list[*changed_handle_list_len] = read_handle_list[pos];
+            (*changed_handle_list_len)++;
+         }
       }
    }
-   LEAVE_ACCESS_DATA();
+   edge_data_readers.fetch_sub(1, std::memory_order_release);
    return ret;
 }
 
-/** Write list of handles out **/
-E_EDGE_DATA_RETVAL edge_data_sync_write(T_EDGE_DATA_HANDLE* write_handle_list, uint32_t write_handle_list_len)
+E_EDGE_DATA_RETVAL edge_data_sync_read(T_EDGE_DATA_HANDLE* read_handle_list, uint32_t read_handle_list_len)
+{
+   return edgedata_app_sync_read(read_handle_list, read_handle_list_len, NULL, NULL);
+}
+
+/** Takes over only values changed since its last call **/
+E_EDGE_DATA_RETVAL edge_data_sync_read_changed(T_EDGE_DATA_HANDLE* read_handle_list, uint32_t read_handle_list_len, T_EDGE_DATA_HANDLE* changed_handle_list, uint32_t* changed_handle_list_len)
+{
+   if ((changed_handle_list == NULL) || (changed_handle_list_len == NULL))
+   {
+      return E_EDGE_DATA_RETVAL_NOK;
+   }
+   *changed_handle_list_len = 0;
+   return edgedata_app_sync_read(read_handle_list, read_handle_list_len, changed_handle_list, changed_handle_list_len);
+}
+
+static int64_t edgedata_app_sync_timestamp()
 {
-   E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
    struct timeval tv;
-   int64_t timestamp64_sync_time = 0;
    if (gettimeofday(&tv, NULL) == 0)
    {
-      timestamp64_sync_time = ((int64_t)((int64_t)tv.tv_sec * 1000000000) + (int64_t)((int64_t)tv.tv_usec * 1000));
+      return ((int64_t)((int64_t)tv.tv_sec * 1000000000) + (int64_t)((int64_t)tv.tv_usec * 1000));
    }
+   return 0;
+}
+
+/* takes over the application value of a write handle (ENTER_ACCESS_DATA has to be held) */
+static bool edgedata_app_take_write_value(T_EDGE_DATA_HANDLE handle, int64_t timestamp64_sync_time, T_EDGE_DATA* data)
+{
+   EDGEDATA_VALUES* values = edgedata_data_table_find(&edge_data_fd->write_values, handle);
+   /* found handle? */
+   if (values == NULL)
+   {
+      return false;
+   }
+   edgedata_data_value_write_begin(values);
+   (void)memcpy(values->internal, values->external, sizeof(T_EDGE_DATA));
+   (void)memcpy(data, values->internal, sizeof(T_EDGE_DATA));
+   edgedata_data_value_write_end(values);
+   /* time stamp available ? */
+   if (data->timestamp64 == 0)
+   {
+      data->timestamp64 = timestamp64_sync_time;
+   }
+   return true;
+}
+
+/** Write list of handles out **/
+E_EDGE_DATA_RETVAL edge_data_sync_write(T_EDGE_DATA_HANDLE* write_handle_list, uint32_t write_handle_list_len)
+{
+   return edge_data_sync_write_timeout(write_handle_list, write_handle_list_len, RPC_REPLY_TIMEOUT_MS);
+}
+
+/** Write list of handles out, one deadline for all replies **/
+E_EDGE_DATA_RETVAL edge_data_sync_write_timeout(T_EDGE_DATA_HANDLE* write_handle_list, uint32_t write_handle_list_len, uint32_t timeout_ms)
+{
+   E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
+   int64_t timestamp64_sync_time = edgedata_app_sync_timestamp();
+   int64_t deadline_ms = edgedata_time_ms() + timeout_ms;
+   EDGEDATA_IPC_FD* caller_fd;
    ENTER_ACCESS_APP();
    if (write_handle_list == NULL)
    {
@@ -1557,29 +4582,37 @@ E_EDGE_DATA_RETVAL edge_data_sync_write(T_EDGE_DATA_HANDLE* write_handle_list, u
    {
       ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
    }
+   else if (edge_data_fd->b_recv_busy)
+   {  /* called by a callback of edge_data_process, waiting would need a nested receive */
+      ret = E_EDGE_DATA_RETVAL_WOULD_BLOCK;
+   }
    else
    {
+      /* all values are sent before the first reply is waited for (one round trip for the whole list) */
+      std::vector<EDGEDATA_RPC_PENDING> pending(write_handle_list_len);
+      uint32_t pending_len = 0;
       ENTER_ACCESS_DATA();
       for (uint32_t pos = 0; pos < write_handle_list_len; pos++)
       {
-         map<uint32_t, EDGEDATA_VALUES>::iterator it = edge_data_fd->write_values.find(write_handle_list[pos]);
-         /* found handle? */
-         if (it != edge_data_fd->write_values.end())
-         {   /* write out value */
-            (void)memcpy(it->second.internal, it->second.external, sizeof(T_EDGE_DATA));
-            int64_t timestamp64 = it->second.internal->timestamp64;
-            uint32_t handle = it->second.internal->handle;
-            E_EDGE_DATA_TYPE type = it->second.internal->type;
-            uint32_t quality = it->second.internal->quality;
-            T_EDGE_DATA_VALUE value;
-            (void)memcpy(&value, &it->second.internal->value, sizeof(T_EDGE_DATA_VALUE));
-            /* time stamp available ? */
-            if (timestamp64 == 0)
+         T_EDGE_DATA data;
+         if (edgedata_app_take_write_value(write_handle_list[pos], timestamp64_sync_time, &data))
+         {   /* write out value (as soon as the backend has credit for it) */
+            LEAVE_ACCESS_DATA();
+            int64_t remaining_ms = deadline_ms - edgedata_time_ms();
+            if (!edgedata_rpc_credit_wait(edge_data_fd, (remaining_ms > 0) ? (uint32_t)remaining_ms : 0))
             {
-               timestamp64 = timestamp64_sync_time;
+               ret = (edge_data_fd->b_connected) ? E_EDGE_DATA_RETVAL_TIMEOUT : E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
+               ENTER_ACCESS_DATA();
+               break;
+            }
+            if (edgedata_flatbuffers_edge_event_send_begin((void*)edge_data_fd, data.handle, data.type, data.quality, &data.value, data.timestamp64, &pending[pending_len]))
+            {
+               pending_len++;
+            }
+            else
+            {
+               ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
             }
-            LEAVE_ACCESS_DATA();
-            edgedata_flatbuffers_edge_event_send((void*)edge_data_fd, handle, type, quality, &value, timestamp64);
             ENTER_ACCESS_DATA();
          }
          else
@@ -1590,8 +4623,119 @@ E_EDGE_DATA_RETVAL edge_data_sync_write(T_EDGE_DATA_HANDLE* write_handle_list, u
          }
       }
       LEAVE_ACCESS_DATA();
+      for (uint32_t i = 0; i < pending_len; i++)
+      {
+         int64_t remaining_ms = deadline_ms - edgedata_time_ms();
+         if ((!edgedata_rpc_wait_for_reply(edge_data_fd, &pending[i], (remaining_ms > 0) ? (uint32_t)remaining_ms : 0)) && (ret == E_EDGE_DATA_RETVAL_OK))
+         {
+            ret = pending[i].b_timeout ? E_EDGE_DATA_RETVAL_TIMEOUT : E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
+         }
+      }
+   }
+   caller_fd = edgedata_app_caller_fd();
+   LEAVE_ACCESS_APP();
+   if (caller_fd != NULL)
+   {
+      edgedata_rpc_run_deferred_callbacks(caller_fd);
+   }
+   return ret;
+}
+
+static T_EDGE_DATA_TOKEN edge_data_write_token = 0;
+
+static void edgedata_app_write_batch_release(EDGEDATA_WRITE_BATCH* batch)
+{
+   if (batch->outstanding.fetch_sub(1) == 1)
+   {
+      batch->cb(batch->token, batch->b_error ? E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY : E_EDGE_DATA_RETVAL_OK, batch->context);
+      delete batch;
+   }
+}
+
+/* receive thread: reply of one value of the batch */
+static void edgedata_app_write_batch_reply(void* fd, void* context, bool b_ok)
+{
+   EDGEDATA_WRITE_BATCH* batch = (EDGEDATA_WRITE_BATCH*)context;
+   if (!b_ok)
+   {
+      batch->b_error = true;
+   }
+   edgedata_app_write_batch_release(batch);
+}
+
+/** Write list of handles out without waiting for the replies **/
+E_EDGE_DATA_RETVAL edge_data_sync_write_async(T_EDGE_DATA_HANDLE* write_handle_list, uint32_t write_handle_list_len, cb_edge_data_write_complete cb, void* context, T_EDGE_DATA_TOKEN* token)
+{
+   E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
+   EDGEDATA_WRITE_BATCH* batch = NULL;
+   int64_t timestamp64_sync_time = edgedata_app_sync_timestamp();
+   ENTER_ACCESS_APP();
+   if ((write_handle_list == NULL) || (cb == NULL))
+   {
+      ret = E_EDGE_DATA_RETVAL_NOK;
+   }
+   else if (edge_data_fd == NULL)
+   {
+      ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
+   }
+   else if (!edge_data_fd->b_connected)
+   {
+      ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
+   }
+   else
+   {
+      /* check all handles first, nothing is sent for an invalid list */
+      ENTER_ACCESS_DATA();
+      for (uint32_t pos = 0; pos < write_handle_list_len; pos++)
+      {
+         if (edgedata_data_table_find(&edge_data_fd->write_values, write_handle_list[pos]) == NULL)
+         {
+            ERROR_LOG("edge_data_sync_write_async Invalid Handle\n");
+            ret = E_EDGE_DATA_RETVAL_UNKNOWN_HANDLE;
+            break;
+         }
+      }
+      LEAVE_ACCESS_DATA();
+      if ((ret == E_EDGE_DATA_RETVAL_OK) && (!edgedata_rpc_credit_try(edge_data_fd, write_handle_list_len)))
+      {  /* backend is behind, the credit callback tells when to retry */
+         ret = E_EDGE_DATA_RETVAL_WOULD_BLOCK;
+      }
+   }
+   if (ret == E_EDGE_DATA_RETVAL_OK)
+   {
+      batch = new EDGEDATA_WRITE_BATCH();
+      batch->outstanding = 1;
+      batch->b_error = false;
+      batch->token = ++edge_data_write_token;
+      batch->cb = cb;
+      batch->context = context;
+      if (token != NULL)
+      {
+         *token = batch->token;
+      }
+      ENTER_ACCESS_DATA();
+      for (uint32_t pos = 0; pos < write_handle_list_len; pos++)
+      {
+         T_EDGE_DATA data;
+         if (edgedata_app_take_write_value(write_handle_list[pos], timestamp64_sync_time, &data))
+         {
+            LEAVE_ACCESS_DATA();
+            batch->outstanding++;
+            if (!edgedata_flatbuffers_edge_event_send_async((void*)edge_data_fd, data.handle, data.type, data.quality, &data.value, data.timestamp64, edgedata_app_write_batch_reply, batch))
+            {
+               batch->b_error = true;
+               batch->outstanding--;
+            }
+            ENTER_ACCESS_DATA();
+         }
+      }
+      LEAVE_ACCESS_DATA();
    }
    LEAVE_ACCESS_APP();
+   if (batch != NULL)
+   {  /* calls cb if all replies already arrived */
+      edgedata_app_write_batch_release(batch);
+   }
    return ret;
 }
 
@@ -1600,22 +4744,22 @@ E_EDGE_DATA_RETVAL edge_data_subscribe_event(uint32_t handle, cb_edge_data_subsc
 {
    E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
    ENTER_ACCESS_DATA();
-   if (edge_data_fd == NULL)
+   if ((edge_data_fd == NULL) || (!edge_data_fd->b_discovered))
    {
       ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
    }
    else
    {
-      map<uint32_t, EDGEDATA_VALUES>::iterator it = edge_data_fd->read_values.find(handle);
+      EDGEDATA_VALUES* values = edgedata_data_table_find(&edge_data_fd->read_values, handle);
       /* unknown handle? */
-      if (it == edge_data_fd->read_values.end())
+      if (values == NULL)
       {
          ERROR_LOG("edge_data_subscribe_event Invalid Handle\n");
          ret = E_EDGE_DATA_RETVAL_UNKNOWN_HANDLE;
       }
       else
-      {
-         it->second.cb = cb;
+      {  /* read by the receive thread without lock */
+         __atomic_store_n(&values->cb, cb, __ATOMIC_RELEASE);
       }
    }
    LEAVE_ACCESS_DATA();
@@ -1631,4 +4775,153 @@ E_EDGE_DATA_RETVAL edge_data_register_logger(cb_edge_data_logger cb)
    return E_EDGE_DATA_RETVAL_OK;
 }
 
+/** Register a callback for returning credit (see E_EDGE_DATA_RETVAL_WOULD_BLOCK) **/
+E_EDGE_DATA_RETVAL edge_data_register_credit_callback(cb_edge_data_credit cb, void* context)
+{
+   ENTER_ACCESS_DATA();
+   edge_data_credit_context = context;
+   edge_data_credit_cb = cb;
+   LEAVE_ACCESS_DATA();
+   return E_EDGE_DATA_RETVAL_OK;
+}
+
+/** Statistics of the current connection **/
+E_EDGE_DATA_RETVAL edge_data_get_statistics(T_EDGE_DATA_STATISTICS* statistics)
+{
+   E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
+   if (statistics == NULL)
+   {
+      return E_EDGE_DATA_RETVAL_NOK;
+   }
+   ENTER_ACCESS_DATA();
+   if (edge_data_fd == NULL)
+   {
+      (void)memset(statistics, 0, sizeof(T_EDGE_DATA_STATISTICS));
+      ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
+   }
+   else
+   {
+      (void)memcpy(statistics, &edge_data_fd->statistics, sizeof(T_EDGE_DATA_STATISTICS));
+      /* calls and execution time per handler are counted in the dispatch table */
+      for (uint32_t message_type = 0; message_type < MSG_TYPE_MAX; message_type++)
+      {
+         statistics->callback_calls += edge_data_fd->dispatch[message_type].calls;
+         statistics->callback_time_ns += edge_data_fd->dispatch[message_type].time_ns;
+      }
+      statistics->event_callback_calls = edge_data_fd->dispatch[MSG_TYPE_UPDATE_DATA].calls;
+      statistics->event_callback_time_ns = edge_data_fd->dispatch[MSG_TYPE_UPDATE_DATA].time_ns;
+   }
+   LEAVE_ACCESS_DATA();
+   return ret;
+}
+
+/** Event fd signaled whenever a value changed by an event (edge_data_sync_read takes it over) **/
+int32_t edge_data_get_event_fd()
+{
+   ENTER_ACCESS_DATA();
+   if (edge_data_event_fd < 0)
+   {
+      int32_t event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (event_fd < 0)
+      {
+         ERROR_LOG("Error create event fd\n");
+      }
+      /* read by the receive thread without lock */
+      __atomic_store_n(&edge_data_event_fd, event_fd, __ATOMIC_RELEASE);
+   }
+   LEAVE_ACCESS_DATA();
+   return edge_data_event_fd;
+}
+
+/** File descriptor of the receive loop, only without receive thread **/
+int32_t edge_data_get_fd()
+{
+   int32_t ret = -1;
+   ENTER_ACCESS_APP();
+   if ((edge_data_fd != NULL) && (edge_data_fd->b_recv_by_caller))
+   {
+      ret = edge_data_fd->recv_epoll_fd;
+   }
+   LEAVE_ACCESS_APP();
+   return ret;
+}
+
+/** Receive loop on the calling thread, callbacks are called from here (or while a sync call waits) **/
+E_EDGE_DATA_RETVAL edge_data_process(int32_t timeout_ms)
+{
+   E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
+   EDGEDATA_IPC_FD* fd;
+   ENTER_ACCESS_APP();
+   fd = edge_data_fd;
+   if ((fd == NULL) || (!fd->b_connected))
+   {
+      ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
+   }
+   else if (!fd->b_recv_by_caller)
+   {  /* the receive thread processes the connection */
+      ret = E_EDGE_DATA_RETVAL_NOK;
+   }
+   else if (fd->b_recv_busy)
+   {  /* called by a callback of edge_data_process */
+      ret = E_EDGE_DATA_RETVAL_WOULD_BLOCK;
+   }
+   LEAVE_ACCESS_APP();
+   /* without ACCESS_APP, callbacks may call edge_data_sync_write_async */
+   if (ret == E_EDGE_DATA_RETVAL_OK)
+   {
+      edgedata_rpc_run_deferred_callbacks(fd);
+      if (!edgedata_thread_recv_process(fd, timeout_ms))
+      {
+         ret = E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY;
+      }
+   }
+   return ret;
+}
+
+/** Set a runtime option **/
+E_EDGE_DATA_RETVAL edge_data_set_option(E_EDGE_DATA_OPTION option, int64_t value)
+{
+   E_EDGE_DATA_RETVAL ret = E_EDGE_DATA_RETVAL_OK;
+   ENTER_ACCESS_APP();
+   switch (option)
+   {
+   case E_EDGE_DATA_OPTION_SHARED_MEMORY:
+      edgedata_ipc_config.b_shared_memory = (value != 0);
+      break;
+   case E_EDGE_DATA_OPTION_SEQPACKET:
+      edgedata_ipc_config.b_seqpacket = (value != 0);
+      break;
+   case E_EDGE_DATA_OPTION_IO_URING:
+      edgedata_ipc_config.b_io_uring = (value != 0);
+      break;
+   case E_EDGE_DATA_OPTION_BUSY_POLL_US:
+      if (value < 0)
+      {
+         ret = E_EDGE_DATA_RETVAL_NOK;
+         break;
+      }
+      edgedata_ipc_config.busy_poll_us = value;
+      if (edge_data_fd != NULL)
+      {  /* read by the receive thread before every read */
+         __atomic_store_n(&edge_data_fd->config.busy_poll_us, value, __ATOMIC_RELAXED);
+      }
+      break;
+   case E_EDGE_DATA_OPTION_RECV_THREAD_CPU:
+      if ((value < -1) || (value >= CPU_SETSIZE))
+      {
+         ret = E_EDGE_DATA_RETVAL_NOK;
+         break;
+      }
+      edgedata_ipc_config.recv_thread_cpu = (int32_t)value;
+      break;
+   case E_EDGE_DATA_OPTION_PROCESS_BY_CALLER:
+      edgedata_ipc_config.b_process_by_caller = (value != 0);
+      break;
+   default:
+      ret = E_EDGE_DATA_RETVAL_NOK;
+      break;
+   }
+   LEAVE_ACCESS_APP();
+   return ret;
+}
 
@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <pthread.h>
+#include <sched.h>
 #include <string.h>
 #include <vector>
 #include <time.h>
@@ -36,22 +37,79 @@
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <pwd.h>
+#include <poll.h>
+#include <errno.h>
+#include <atomic>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
 //#include <arpa/inet.h>
 
 #define MSG_MAX_FULL_SIZE                 4096
 #define MAX_PAYLOAD_SIZE                  (MSG_MAX_FULL_SIZE - sizeof(EDGEDATA_RPC_HEADER))
-#define MAX_NUMBER_SUPPORTED_DATAPOINTS   10000
+#define RECV_BUFFER_SIZE                  (16 * MSG_MAX_FULL_SIZE)
+#define MSG_MAX_LARGE_PAYLOAD_SIZE        (1024 * 1024) /* sent as fragments of MAX_PAYLOAD_SIZE */
+#define DISCOVER_ARENA_BLOCK_SIZE         (64 * 1024) /* minimum block, a discover message gets one block for all its data points */
 #define SOCKET_TIMEOUT_SECONDS            8
 #define KEEP_ALIVE_PING_SECONDS           3
+#define RPC_REPLY_TIMEOUT_MS              (SOCKET_TIMEOUT_SECONDS * 1000)
 #define MAX_DISCOVERED_DATAPOINTS_PER_MSG 20
+#define MAX_DISCOVERED_DATAPOINTS_PER_LARGE_MSG 1000
+#define SERVER_MAX_EVENTS                 64
+#define SERVER_LOOP_TIMEOUT_MS            1000
+#define SERVER_SEND_QUEUE_MAX             (1024 * 1024) /* queued bytes per connection, more -> the connection is closed */
+#define SERVER_SEND_QUEUE_TIMEOUT_MS      (SOCKET_TIMEOUT_SECONDS * 1000) /* peer took no queued byte for this time -> closed */
+#define SERVER_SHM_FLUSH_MS               1    /* loop cycle while a shared memory ring of a connection is full */
+#define EVENT_STREAM_WINDOW               64   /* unacknowledged stream events per connection */
+#define EVENT_STREAM_ACK_MESSAGES         16   /* receiver acknowledges at least every N events ... */
+#define EVENT_STREAM_ACK_MS               10   /* ... or T ms after the oldest unacknowledged one */
+#define RPC_LANE_CONTROL                  0    /* ping, discover, replies and acks: sent before waiting bulk messages */
+#define RPC_LANE_BULK                     1    /* data updates */
+#define RPC_LANES                         2
+#define RPC_CREDITS                       32   /* at most advertised, less if the receive socket or ring has no room for more full frames */
 
 #define MSG_TYPE_PING                     0
 #define MSG_TYPE_DISCOVER                 1
 #define MSG_TYPE_UPDATE_DATA              2
+#define MSG_TYPE_SHM_SETUP                3
+#define MSG_TYPE_CAPABILITIES             4
+#define MSG_TYPE_EVENT_ACK                5    /* cumulative number of stream events received */
+#define MSG_TYPE_MAX                      16   /* size of the dispatch table, new message types must be smaller */
 
 
 #define MSG_CONTROL_FLAG_REQUEST        0x01
 #define MSG_CONTROL_FLAG_REPLY          0x02
+#define MSG_CONTROL_FLAG_FRAGMENT       0x04  /* more fragments of this message follow */
+#define MSG_CONTROL_FLAG_STREAM         0x08  /* no reply, acknowledged by MSG_TYPE_EVENT_ACK */
+
+#define CAPABILITY_FRAGMENTATION        0x00000001
+#define CAPABILITY_EVENT_STREAM         0x00000002
+#define CAPABILITY_CREDITS              0x00000004  /* msg_credits is valid */
+#define EDGEDATA_CAPABILITIES           (CAPABILITY_FRAGMENTATION | CAPABILITY_EVENT_STREAM | CAPABILITY_CREDITS)
+
+#define SHM_MAGIC                       0x45444753  /* "EDGS" */
+#define SHM_RING_SIZE                   (256 * 1024) /* per direction, power of two */
+#define SHM_SETUP_FDS                   5    /* memfd, data and space event fd per direction */
+#define SHM_SEALS                       (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) /* required by the server, size of the memfd is fixed */
+
+#define URING_QUEUE_DEPTH               8
+#define URING_BUFFER_COUNT              8            /* provided receive buffers, power of two */
+#define URING_BUFFER_SIZE               (4 * MSG_MAX_FULL_SIZE)
+#define URING_BUFFER_GROUP              0
+
+/* io_uring receive needs multishot recv (kernel headers >= 6.0), checked again at runtime */
+#ifdef IORING_RECV_MULTISHOT
+#define ENABLE_IO_URING         1
+#else
+#define ENABLE_IO_URING         0
+#endif
 
 #define ENABLE_DEBUG_LOCK_LOG   0
 #define ENABLE_DEBUG_IPC_LOG    0
@@ -100,8 +158,8 @@
 #define ENTER_CRITICAL_SECTION(__fd) DEBUG_LOCK_LOG("Lock Critical Section\n"); pthread_mutex_lock(&__fd->critical_section_mutex); DEBUG_LOCK_LOG("Lock Ciritical Section OK\n")
 #define LEAVE_CRITICAL_SECTION(__fd) DEBUG_LOCK_LOG("UnLock Ciritical Section\n"); pthread_mutex_unlock(&__fd->critical_section_mutex)
 
-#define ENTER_WAIT_FOR_REPLY(__fd) DEBUG_LOCK_LOG("Lock Wait for Reply\n"); pthread_mutex_lock(&__fd->wait_for_reply_mutex); DEBUG_LOCK_LOG("Lock Wait for Reply OK\n")
-#define LEAVE_WAIT_FOR_REPLY(__fd) DEBUG_LOCK_LOG("UnLock Wait for Reply\n"); pthread_mutex_unlock(&__fd->wait_for_reply_mutex)
+#define ENTER_PENDING_REQUESTS(__fd) DEBUG_LOCK_LOG("Lock Pending Requests\n"); pthread_mutex_lock(&__fd->pending_requests_mutex); DEBUG_LOCK_LOG("Lock Pending Requests OK\n")
+#define LEAVE_PENDING_REQUESTS(__fd) DEBUG_LOCK_LOG("UnLock Pending Requests\n"); pthread_mutex_unlock(&__fd->pending_requests_mutex)
 
 #define ENTER_ACCESS_DATA() DEBUG_LOCK_LOG("Lock Access Data\n"); pthread_mutex_lock(&edge_data_access_mutex); DEBUG_LOCK_LOG("Lock Access Data OK\n")
 #define LEAVE_ACCESS_DATA() DEBUG_LOCK_LOG("UnLock Access Data\n"); pthread_mutex_unlock(&edge_data_access_mutex)
@@ -114,7 +172,8 @@ typedef struct {
    uint32_t msg_payload_len;
    uint32_t msg_sequence;
    uint8_t  msg_control_flags;
-   uint8_t  msg_reserve[3];
+   uint8_t  msg_reserve;
+   uint16_t msg_credits;     /* outstanding requests the sender of this message accepts */
 } EDGEDATA_RPC_HEADER;
 
 typedef struct {
@@ -124,27 +183,148 @@ typedef struct {
 
 typedef void (*fct_callback_message)(void* fd, unsigned char* payload, uint32_t payload_len);
 typedef uint32_t(*fct_callback_message_with_reply)(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len);
-typedef int32_t(*fct_read) (int32_t fd, void* buff, uint32_t buff_len);
-typedef int32_t(*fct_write) (int32_t fd, void* buff, uint32_t buff_len);
+typedef int32_t(*fct_read) (void* fd, void* buff, uint32_t buff_len);
+typedef int32_t(*fct_write) (void* fd, struct iovec* iov, uint32_t iov_len);
 typedef void (*fct_error_connection) (void* fd);
+typedef void (*fct_server_connection) (void* fd);
+typedef void (*fct_server_broadcast) (void* fd, void* context);
+typedef void (*fct_rpc_completion) (void* fd, void* context, bool b_ok);
+typedef void (*fct_credit_available) (void* fd);
+
+/* Dispatch table entry, indexed by message type */
+typedef struct {
+   fct_callback_message                      cb;               /* fire and forget messages and replies */
+   fct_callback_message_with_reply           cb_with_reply;    /* requests and stream events */
+   uint64_t                                  calls;
+   uint64_t                                  time_ns;          /* cumulative execution time of both callbacks */
+} EDGEDATA_DISPATCH_ENTRY;
+
+/* Outstanding request (owned by the sender until the reply is waited for), completed by the receive thread */
+typedef struct {
+   uint32_t                                  sequence;
+   bool                                      b_done;
+   bool                                      b_error;
+   bool                                      b_timeout;        /* no reply before the deadline (b_error is set as well) */
+   pthread_cond_t                            cond;             /* CLOCK_MONOTONIC */
+   fct_rpc_completion                        cb;               /* asynchronous request: called instead of cond, entry is freed */
+   void*                                     context;
+} EDGEDATA_RPC_PENDING;
+
+/* edge_data_sync_write_async: completed when the last reply arrived (the caller holds one reference while sending) */
+typedef struct {
+   std::atomic<uint32_t>                     outstanding;
+   std::atomic<bool>                         b_error;
+   T_EDGE_DATA_TOKEN                         token;
+   cb_edge_data_write_complete               cb;
+   void*                                     context;
+} EDGEDATA_WRITE_BATCH;
+
+/* Process by caller: application callback of a receive inside an API call holding ACCESS_APP, run after the call */
+typedef struct {
+   cb_edge_data_subscribe                    event_cb;         /* value changed, NULL -> asynchronous request completed */
+   T_EDGE_DATA                               event;
+   EDGEDATA_RPC_PENDING*                     pending;
+} EDGEDATA_DEFERRED_CALLBACK;
+
+/* Runtime configuration, copied into every new EDGEDATA_IPC_FD */
+typedef struct {
+   bool                                      b_shared_memory;
+   bool                                      b_seqpacket;
+   bool                                      b_io_uring;
+   int64_t                                   busy_poll_us;     /* spin budget of a blocking read, 0 -> off (__atomic_ access) */
+   int32_t                                   recv_thread_cpu;  /* -1 -> no pinning */
+   bool                                      b_process_by_caller; /* no receive thread, see edge_data_process */
+} EDGEDATA_IPC_CONFIG;
+
+/* Single producer single consumer ring inside the shared memory (one per direction) */
+typedef struct {
+   alignas(64) std::atomic<uint32_t>         head;             /* written by producer */
+   alignas(64) std::atomic<uint32_t>         tail;             /* written by consumer */
+   alignas(64) std::atomic<uint32_t>         consumer_waiting; /* consumer sleeps on eventfd */
+   alignas(64) std::atomic<uint32_t>         producer_waiting; /* producer sleeps on eventfd until the ring has space */
+   alignas(64) unsigned char                 data[SHM_RING_SIZE];
+} EDGEDATA_SHM_RING;
+
+typedef struct {
+   uint32_t                                  magic;
+   uint32_t                                  ring_size;
+   EDGEDATA_SHM_RING                         client_to_server;
+   EDGEDATA_SHM_RING                         server_to_client;
+} EDGEDATA_SHM_AREA;
 
+/* Payload of MSG_TYPE_SHM_SETUP request and reply */
 typedef struct {
-   uint32_t                message_type;
-   fct_callback_message    cb;
-} EDGEDATA_CALLBACK;
+   uint32_t                                  magic;
+   uint32_t                                  ring_size;
+} EDGEDATA_SHM_SETUP;
 
 typedef struct {
-   uint32_t                         message_type;
-   fct_callback_message_with_reply  cb;
-} EDGEDATA_CALLBACK_WITH_REPLY;
+   int32_t                                   mem_fd;
+   int32_t                                   recv_event_fd;    /* signaled by peer if recv_ring gets data */
+   int32_t                                   send_event_fd;    /* signaled by us if send_ring gets data */
+   int32_t                                   send_space_fd;    /* signaled by peer if send_ring gets space */
+   int32_t                                   recv_space_fd;    /* signaled by us if recv_ring gets space */
+   EDGEDATA_SHM_AREA*                        area;
+   EDGEDATA_SHM_RING*                        recv_ring;
+   EDGEDATA_SHM_RING*                        send_ring;
+} EDGEDATA_SHM_TRANSPORT;
+
+#if ENABLE_IO_URING != 0
+/* io_uring with one multishot recv on the socket, data arrives in provided buffers */
+typedef struct {
+   int32_t                                   ring_fd;
+   void*                                     sq_ring;
+   size_t                                    sq_ring_size;
+   void*                                     cq_ring;          /* == sq_ring with IORING_FEAT_SINGLE_MMAP */
+   size_t                                    cq_ring_size;
+   struct io_uring_sqe*                      sqes;
+   size_t                                    sqes_size;
+   uint32_t*                                 sq_head;
+   uint32_t*                                 sq_tail;
+   uint32_t*                                 sq_array;
+   uint32_t                                  sq_mask;
+   uint32_t*                                 cq_head;
+   uint32_t*                                 cq_tail;
+   uint32_t                                  cq_mask;
+   struct io_uring_cqe*                      cqes;
+   struct io_uring_buf_ring*                 buf_ring;
+   unsigned char*                            buffers;
+   uint32_t                                  to_submit;
+   bool                                      b_armed;          /* multishot recv is active */
+   bool                                      b_received;       /* at least one completion with data */
+   bool                                      b_pending;        /* buffer partly handed out */
+   uint16_t                                  pending_bid;
+   uint32_t                                  pending_offset;
+   uint32_t                                  pending_len;
+} EDGEDATA_URING;
+#else
+typedef struct {
+   int32_t                                   ring_fd;
+} EDGEDATA_URING;
+#endif
 
 typedef struct {
-   std::string* p_topic;
    T_EDGE_DATA* external;
    T_EDGE_DATA* internal;
    cb_edge_data_subscribe  cb;
+   uint32_t     seq;              /* seqlock of internal: odd while it is written */
 } EDGEDATA_VALUES;
 
+/* Values of one direction: entries in discover order, found by handle or topic through open addressing indexes */
+typedef struct {
+   std::vector<EDGEDATA_VALUES>              entries;
+   std::vector<uint64_t>                     slots;            /* handle << 32 | entry position + 1, 0 is free (power of two) */
+   std::vector<uint64_t>                     topic_slots;      /* topic hash << 32 | entry position + 1, same size */
+   std::vector<uint64_t>                     dirty;            /* bit per entry: internal changed since it was copied to external */
+} EDGEDATA_VALUE_TABLE;
+
+/* Discover data of a connection, freed at once: values grow from the front of a block, topics from its end */
+typedef struct {
+   std::vector<uint64_t*>                    blocks;
+   unsigned char*                            p_front;
+   unsigned char*                            p_back;
+} EDGEDATA_ARENA;
+
 typedef struct {
    /* Read/Write Low Level */
    int32_t                                   read_fd;
@@ -156,37 +336,129 @@ typedef struct {
    fct_read                                  read;
    fct_write                                 write;
    fct_error_connection                      error_connection_cb;
-   /* Read/Write Messages */
-   EDGEDATA_RPC_FULL_MSG                     send_message;
+   EDGEDATA_IPC_CONFIG                       config;
+   bool                                      b_nonblocking;    /* reads return EAGAIN, the receive or server loop polls */
+   bool                                      b_would_block;    /* last read stopped, no complete message available */
+   bool                                      b_spinning;       /* busy poll: read functions must not block */
+   /* Shared Memory Transport (NULL -> unix socket only) */
+   EDGEDATA_SHM_TRANSPORT*                   shm;
+   EDGEDATA_SHM_TRANSPORT*                   shm_pending;      /* server: activated with setup reply */
+   int32_t                                   received_fds[SHM_SETUP_FDS];
+   uint32_t                                  received_fds_len;
+   /* io_uring receive (NULL -> read() on the socket) */
+   EDGEDATA_URING*                           uring;
+   /* Read/Write Messages (payload is sent from the caller buffer) */
+   EDGEDATA_RPC_HEADER                       send_header;
    EDGEDATA_RPC_FULL_MSG                     recv_message;
+   EDGEDATA_RPC_FULL_MSG*                    p_recv_message;   /* points into recv_buffer or to recv_message */
+   /* Receive Buffer (may hold several frames, partial frames are kept) */
+   alignas(8) unsigned char                  recv_buffer[RECV_BUFFER_SIZE];
+   uint32_t                                  recv_buffer_start;
+   uint32_t                                  recv_buffer_end;
+   T_EDGE_DATA_STATISTICS                    statistics;
    /* RPC Layer           */
    uint32_t                                  sequence;
-   bool                                      b_wait_for_reply;
-   bool                                      b_wait_for_reply_error;
-   uint32_t                                  wait_for_reply_sequence;
-   pthread_mutex_t                           wait_for_reply_mutex;
-   pthread_mutex_t                           single_concurrent_request_mutex;
+   uint32_t                                  peer_capabilities; /* MSG_TYPE_CAPABILITIES, 0 for older peers */
+   std::vector<unsigned char>                reassembly;       /* fragments of a large message (capacity is kept) */
+   uint32_t                                  reassembly_type;
+   uint32_t                                  reassembly_sequence;
+   bool                                      b_reassembled;    /* reassembly holds the last returned message */
+   unsigned char*                            p_large_reply;    /* reply buffer for peers with CAPABILITY_FRAGMENTATION */
+   std::map<uint32_t, EDGEDATA_RPC_PENDING*> pending_requests; /* keyed by msg_sequence, several requests in flight */
+   bool                                      b_pending_requests_closed; /* no more replies, new requests fail */
+   /* Credits (guarded by pending_requests_mutex) */
+   uint32_t                                  peer_credits;     /* msg_credits of the peer, limits pending_requests */
+   bool                                      b_credit_wanted;  /* a request was refused, call credit_cb when credit returns */
+   fct_credit_available                      credit_cb;
+   uint16_t                                  recv_credits;     /* msg_credits sent to the peer, see edgedata_rpc_credits_refresh */
+   bool                                      b_recv_batch_start; /* the last read would block, the next one starts a receive batch */
+   pthread_cond_t                            window_cond;      /* CLOCK_MONOTONIC, signaled when credit or the stream window opens */
+   /* Event Stream (guarded by pending_requests_mutex) */
+   uint32_t                                  stream_sent;      /* sender: events sent ... */
+   uint32_t                                  stream_acked;     /* ... and acknowledged by the peer */
+   uint32_t                                  stream_received;  /* receiver: events received ... */
+   uint32_t                                  stream_ack_sent;  /* ... and acknowledged */
+   int64_t                                   stream_unacked_ms; /* receive time of the oldest unacknowledged event */
+   pthread_mutex_t                           pending_requests_mutex;
    pthread_mutex_t                           critical_section_mutex;
+   /* Send Lanes (a sender enters the critical section only if no sender of a higher priority lane waits) */
+   uint32_t                                  lane_waiting[RPC_LANES];
+   bool                                      b_lane_sending;
+   pthread_mutex_t                           send_lanes_mutex;
+   pthread_cond_t                            send_lanes_cond;
    pthread_t                                 p_thread_recv;
-   pthread_t                                 p_thread_keep_alive;
+   bool                                      b_recv_thread;    /* p_thread_recv was started */
+   bool                                      b_recv_by_caller; /* no receive thread, edge_data_process and waiting callers receive */
+   bool                                      b_recv_busy;      /* process by caller: a receive runs, a nested one is refused */
+   bool                                      b_defer_callbacks; /* process by caller: the receive runs inside an API call holding ACCESS_APP */
+   std::atomic<bool>                         b_credit_cb_deferred; /* credit returned outside of the receive thread, see edgedata_rpc_credit_notify */
+   std::vector<EDGEDATA_DEFERRED_CALLBACK>   deferred_callbacks; /* see edgedata_rpc_run_deferred_callbacks */
+   int32_t                                   recv_epoll_fd;    /* receive loop: shutdown event, keep alive timer and data source */
+   int32_t                                   recv_wait_fd;     /* data source in recv_epoll_fd */
+   int32_t                                   shutdown_event_fd; /* wakes the receive loop on disconnect or for a deferred credit callback */
    bool                                      b_shutdown;
+   /* Keep Alive (receive or server loop only) */
+   int32_t                                   keep_alive_timer_fd; /* timerfd in the epoll set of the receive loop */
+   int32_t                                   stream_ack_timer_fd; /* one shot timerfd in the same set: EVENT_STREAM_ACK_MS after the oldest unacknowledged event */
+   bool                                      b_stream_ack_armed;
+   int64_t                                   last_recv_ms;
+   int64_t                                   last_ping_ms;     /* server: a ping is sent only if nothing was received since */
+   uint32_t                                  last_send_sequence; /* receive loop: a ping is sent if sequence stayed unchanged */
+   int64_t                                   last_send_ms;
+   /* Server Loop (guarded by connections_mutex of the server) */
+   uint32_t                                  ref_count;
+   bool                                      b_shm_polled;     /* shared memory event fd added to epoll */
+   bool                                      b_epollout;       /* loop only: EPOLLOUT armed for the send queue */
+   /* Send Queue (server connections, guarded by critical_section_mutex): a write never waits for the peer, */
+   /* what the transport does not take is queued and sent by the server loop                               */
+   bool                                      b_send_queue;
+   std::vector<unsigned char>                send_queue;       /* complete messages, next byte to send at send_queue_start */
+   uint32_t                                  send_queue_start;
+   int64_t                                   send_progress_ms; /* last time the peer took queued bytes */
+   bool                                      b_send_failed;    /* queue overflow, the loop closes the connection */
+   std::atomic<bool>                         b_send_queued;    /* set with the first queued byte, the loop is woken */
+   int32_t                                   server_wake_fd;
 
    /* Callback Layer */
-   std::vector<EDGEDATA_CALLBACK>            callbacks;
-   std::vector<EDGEDATA_CALLBACK_WITH_REPLY> callbacks_with_reply;
+   EDGEDATA_DISPATCH_ENTRY                   dispatch[MSG_TYPE_MAX]; /* registered before the receive thread starts */
    /* Application Layer */
-   std::map<uint32_t, EDGEDATA_VALUES>       read_values;
-   std::map<uint32_t, EDGEDATA_VALUES>       write_values;
-   /* State of Discover write and read values */
-   std::map<uint32_t, EDGEDATA_VALUES>::iterator  it_read_discover_info;
-   std::map<uint32_t, EDGEDATA_VALUES>::iterator  it_write_discover_info;
+   EDGEDATA_VALUE_TABLE                      read_values;
+   EDGEDATA_VALUE_TABLE                      write_values;
+   std::atomic<bool>                         b_discovered;     /* tables complete, set once by edge_data_connect: readers use them without lock */
+   EDGEDATA_ARENA                            discover_arena;   /* internal/external T_EDGE_DATA and topics of both tables */
+   /* State of Discover write and read values (next entry to serialize) */
+   uint32_t                                  read_discover_pos;
+   uint32_t                                  write_discover_pos;
 } EDGEDATA_IPC_FD;
 
+/* Multi client server: listen socket and all connections are served by one epoll loop */
+typedef struct {
+   int32_t                                   listen_fd;
+   int32_t                                   epoll_fd;
+   int32_t                                   wake_fd;
+   bool                                      b_channel_type_stream;
+   std::string                               channel_name;
+   fct_server_connection                     connected_cb;     /* register callbacks and discover data */
+   fct_server_connection                     disconnected_cb;
+   std::vector<EDGEDATA_IPC_FD*>             connections;      /* modified only by the loop */
+   std::vector<EDGEDATA_IPC_FD*>             closed_connections;
+   std::vector<int32_t>                      pending_sockets;  /* loopback connections, added by the loop */
+   pthread_mutex_t                           connections_mutex;
+   int64_t                                   last_keep_alive_ms;
+   int64_t                                   stream_ack_due_ms; /* loop only: earliest event acknowledgement of the connections, 0 -> none */
+   bool                                      b_shm_send_queued; /* loop only: a connection waits for shared memory ring space */
+   pthread_t                                 p_thread_server;
+   bool                                      b_thread_started;
+   bool                                      b_shutdown;
+} EDGEDATA_IPC_SERVER;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
    extern char pre_logger_text[20];
    extern EDGEDATA_IPC_FD* edge_data_fd;
+   extern EDGEDATA_IPC_CONFIG edgedata_ipc_config;
+   extern EDGEDATA_IPC_SERVER* edgedata_ipc_loopback_server;
 
    extern EDGEDATA_IPC_FD* edgedata_ipc_fifo_server_listen(const char* channel_name);
    extern EDGEDATA_IPC_FD* edgedata_ipc_fifo_client_connect(const char* channel_name);
@@ -194,20 +466,42 @@ extern "C" {
    extern EDGEDATA_IPC_FD* edgedata_ipc_unix_client_connect(const char* channel_name);
    extern EDGEDATA_IPC_FD* edgedata_ipc_unix_server_listen_with_error_cb(const char* channel_name, const char* user, fct_error_connection cb);
 
+   extern EDGEDATA_IPC_SERVER* edgedata_ipc_unix_server_create(const char* channel_name, const char* user, fct_server_connection connected_cb, fct_server_connection disconnected_cb);
+   extern bool edgedata_ipc_server_process(EDGEDATA_IPC_SERVER* server, int32_t timeout_ms);
+   extern uint32_t edgedata_ipc_server_broadcast(EDGEDATA_IPC_SERVER* server, fct_server_broadcast cb, void* context);
+   extern void edgedata_ipc_server_close(EDGEDATA_IPC_SERVER** server);
+   extern EDGEDATA_IPC_SERVER* edgedata_ipc_loopback_server_create(fct_server_connection connected_cb, fct_server_connection disconnected_cb);
+   extern EDGEDATA_IPC_FD* edgedata_ipc_loopback_connect(EDGEDATA_IPC_SERVER* server);
+
+   extern bool edgedata_ipc_shm_client_setup(EDGEDATA_IPC_FD* fd);
+   extern uint32_t edgedata_ipc_shm_setup_with_reply(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len);
+
    extern void edgedata_ipc_disconnect(EDGEDATA_IPC_FD** fd);
    extern bool edgedata_ipc_is_connected(EDGEDATA_IPC_FD* fd);
 
    extern bool edgedata_rpc_send_fire_and_forget(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len);
    extern bool edgedata_rpc_send_request(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len);
    extern bool edgedata_rpc_send_reply(EDGEDATA_IPC_FD* fd, uint32_t message_type, uint32_t reply_sequence, unsigned char* payload, uint32_t payload_len);
+   extern bool edgedata_rpc_send_request_begin(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len, EDGEDATA_RPC_PENDING* pending);
+   extern bool edgedata_rpc_wait_for_reply(EDGEDATA_IPC_FD* fd, EDGEDATA_RPC_PENDING* pending, uint32_t timeout_ms);
+   extern bool edgedata_rpc_send_request_async(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len, fct_rpc_completion cb, void* context);
+   extern bool edgedata_rpc_credit_wait(EDGEDATA_IPC_FD* fd, uint32_t timeout_ms);
+   extern bool edgedata_rpc_credit_try(EDGEDATA_IPC_FD* fd, uint32_t count);
+   extern bool edgedata_rpc_send_stream(EDGEDATA_IPC_FD* fd, uint32_t message_type, unsigned char* payload, uint32_t payload_len);
+   extern int64_t edgedata_rpc_stream_ack(EDGEDATA_IPC_FD* fd, bool b_received);
    extern void edgedata_rpc_dummy_ack(void* fd, unsigned char* p_payload, uint32_t payload_len);
+   extern uint32_t edgedata_rpc_max_payload_len(EDGEDATA_IPC_FD* fd);
+   extern bool edgedata_rpc_capabilities_client_exchange(EDGEDATA_IPC_FD* fd);
+   extern uint32_t edgedata_rpc_capabilities_with_reply(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len);
 
-   extern void edgedata_thread_start_thread_recv(EDGEDATA_IPC_FD* fd);
+   extern bool edgedata_thread_start_thread_recv(EDGEDATA_IPC_FD* fd);
+   extern bool edgedata_thread_recv_process(EDGEDATA_IPC_FD* fd, int32_t timeout_ms);
+   extern void edgedata_rpc_run_deferred_callbacks(EDGEDATA_IPC_FD* fd);
    extern bool edgedata_rpc_recv(EDGEDATA_IPC_FD* fd, uint32_t* p_message_type, uint32_t* p_sequence, uint8_t* p_msg_control_flags, unsigned char** p_payload, uint32_t* p_payload_len);
-   extern void edgedata_thread_start_keep_alive(EDGEDATA_IPC_FD* fd);
+   extern void edgedata_thread_start_server(EDGEDATA_IPC_SERVER* server);
 
-   extern void edgedata_callback_with_reply_register(EDGEDATA_IPC_FD* fd, uint32_t message_type, fct_callback_message_with_reply cb);
-   extern void edgedata_callback_register(EDGEDATA_IPC_FD* fd, uint32_t message_type, fct_callback_message cb);
+   extern bool edgedata_callback_with_reply_register(EDGEDATA_IPC_FD* fd, uint32_t message_type, fct_callback_message_with_reply cb);
+   extern bool edgedata_callback_register(EDGEDATA_IPC_FD* fd, uint32_t message_type, fct_callback_message cb);
 
    extern bool edgedata_data_discover_add(EDGEDATA_IPC_FD* fd, const char* topic, uint32_t handle, E_EDGE_DATA_TYPE type, uint32_t source, uint32_t quality, T_EDGE_DATA_VALUE* init_value, int64_t init_timestamp, cb_edge_data_subscribe cb);
    extern void edgedata_data_print_state(EDGEDATA_IPC_FD* fd);
@@ -217,6 +511,8 @@ extern "C" {
    extern uint32_t edgedata_flatbuffers_discover_serialize(EDGEDATA_IPC_FD* fd, unsigned char* p_payload, uint32_t max_payload_len);
    extern uint32_t edgedata_flatbuffers_discover_with_reply(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len);
    extern bool edgedata_flatbuffers_edge_event_send(void* fd, uint32_t handle, E_EDGE_DATA_TYPE type, uint32_t quality, T_EDGE_DATA_VALUE* value, int64_t timestamp64);
+   extern bool edgedata_flatbuffers_edge_event_send_begin(void* fd, uint32_t handle, E_EDGE_DATA_TYPE type, uint32_t quality, T_EDGE_DATA_VALUE* value, int64_t timestamp64, EDGEDATA_RPC_PENDING* pending);
+   extern bool edgedata_flatbuffers_edge_event_send_async(void* fd, uint32_t handle, E_EDGE_DATA_TYPE type, uint32_t quality, T_EDGE_DATA_VALUE* value, int64_t timestamp64, fct_rpc_completion cb, void* context);
    extern uint32_t edgedata_flatbuffers_edge_event_receive(void* fd, unsigned char* payload, uint32_t payload_len, unsigned char* payload_reply, uint32_t max_payload_reply_len);
 
    extern void edgedata_logger(const char* file, unsigned int line, const char* format, ...);
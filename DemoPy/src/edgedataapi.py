@@ -33,7 +33,9 @@ class E_EDGE_DATA_RETVAL(Enum):
     E_EDGE_DATA_RETVAL_UNKNOWN_TOPIC = -2,
     E_EDGE_DATA_RETVAL_INVALID_VALUE = -3,
     E_EDGE_DATA_RETVAL_ERROR_CONNECTIVITY = -4,
-    E_EDGE_DATA_RETVAL_UNKNOWN_HANDLE = -5
+    E_EDGE_DATA_RETVAL_UNKNOWN_HANDLE = -5,
+    E_EDGE_DATA_RETVAL_TIMEOUT = -6,
+    E_EDGE_DATA_RETVAL_WOULD_BLOCK = -7
 
 
 class E_EDGE_DATA_TYPE(c_int):
@@ -22,6 +22,7 @@
 #include <cstring>
 #include <string>
 #include <map>
+#include <set>
 #include <iterator>
 #include <sstream>
 #include <fstream>
@@ -56,7 +57,9 @@ typedef struct
 
 static map<string, CSV_DATA_INFO>         topic_read_info;
 static map<string, CSV_WRITE_DATA_INFO>   topic_write_info;
-static bool                               b_wait_for_discover = true;
+static set<void*>                         discovered_siapps;   /* connections with finished discover */
+static pthread_mutex_t                    siapps_mutex = PTHREAD_MUTEX_INITIALIZER;
+static EDGEDATA_IPC_SERVER                *server = NULL;
 static bool                               b_connection_ok = false;
 static const char                         *CSV_File1_ptr = NULL;
 static const char                         *CSV_File2_ptr = NULL;
@@ -129,11 +132,35 @@ uint32_t callback_discover_with_reply(void* fd, unsigned char* payload, uint32_t
    uint32_t ret = edgedata_flatbuffers_discover_with_reply(fd, payload, payload_len, payload_reply, max_payload_reply_len);
    if (ret == 0)
    {
-      b_wait_for_discover = false;
+      pthread_mutex_lock(&siapps_mutex);
+      discovered_siapps.insert(fd);
+      pthread_mutex_unlock(&siapps_mutex);
    }
    return ret;
 }
 
+/*!
+******************************************************************************
+DESCRIPTION:     Check if a SIAPP finished the discover
+*****************************************************************************/
+static bool is_discovered(void* fd)
+{
+   bool ret;
+   pthread_mutex_lock(&siapps_mutex);
+   ret = (discovered_siapps.find(fd) != discovered_siapps.end());
+   pthread_mutex_unlock(&siapps_mutex);
+   return ret;
+}
+
+static uint32_t discovered_siapps_count()
+{
+   uint32_t ret;
+   pthread_mutex_lock(&siapps_mutex);
+   ret = discovered_siapps.size();
+   pthread_mutex_unlock(&siapps_mutex);
+   return ret;
+}
+
 /*!
 ******************************************************************************
 DESCRIPTION:     Convert source from string to edge
@@ -389,9 +416,17 @@ static void change_event_cb(T_EDGE_DATA* event)
 {
    char tmp[400];
    uint32_t pos = 0;
+   map<string, CSV_WRITE_DATA_INFO>::iterator it;
 
-   topic_write_info[string(event->topic)].quality = event->quality;
-   (void)memcpy(&topic_write_info[string(event->topic)].value, &event->value, sizeof(T_EDGE_DATA_VALUE));
+   /* called by the server loop, the event loop reads the values */
+   pthread_mutex_lock(&siapps_mutex);
+   it = topic_write_info.find(string(event->topic));
+   if (it != topic_write_info.end())
+   {
+      it->second.quality = event->quality;
+      (void)memcpy(&it->second.value, &event->value, sizeof(T_EDGE_DATA_VALUE));
+   }
+   pthread_mutex_unlock(&siapps_mutex);
 
    pos = snprintf(tmp, sizeof(tmp), "Topic %s received with Value: ", event->topic);
    pos += get_value_text(&event->value, event->type, &tmp[pos], (sizeof(tmp) - pos));
@@ -479,12 +514,52 @@ bool if_file_has_duplicates_topics(const vector<string>& vec)
 }
 /*!
 ******************************************************************************
-DESCRIPTION:     Callback triggerd if connection broken
-\fn  VOID ciotask_cb_error_connection (VOID)
+DESCRIPTION:     Callback triggerd if a SIAPP connection is broken
+*****************************************************************************/
+void cb_disconnected(void* fd)
+{
+   pthread_mutex_lock(&siapps_mutex);
+   discovered_siapps.erase(fd);
+   pthread_mutex_unlock(&siapps_mutex);
+   log("EdgeApp disconnected from Simulation...\n");
+}
+
+/*!
+******************************************************************************
+DESCRIPTION:     Callback triggerd if a SIAPP connects, every SIAPP gets its
+                 own discover state
 *****************************************************************************/
-void cb_error_connection(void* fd)
+void cb_connected(void* fd)
 {
-   b_connection_ok = false;
+   EDGEDATA_IPC_FD* connection = (EDGEDATA_IPC_FD*)fd;
+   struct timeval tv;
+   int64_t timestamp64;
+   T_EDGE_DATA_VALUE init_value;
+
+   (void)edgedata_callback_with_reply_register(connection, MSG_TYPE_DISCOVER, callback_discover_with_reply);
+   (void)edgedata_callback_with_reply_register(connection, MSG_TYPE_UPDATE_DATA, edgedata_flatbuffers_edge_event_receive);
+   (void)edgedata_callback_register(connection, MSG_TYPE_UPDATE_DATA, edgedata_rpc_dummy_ack);
+   log("EdgeApp connected to Simulation...\n");
+
+   for (map<string, CSV_WRITE_DATA_INFO>::iterator it = topic_write_info.begin(); it != topic_write_info.end(); it++)
+   {
+      (void)memset(&init_value, 0, sizeof(init_value));
+      log("EdgeApp edgedata_data_discover_add (write)...\n");
+      edgedata_data_discover_add(connection, it->first.c_str(), it->second.handle, it->second.type, EDGE_SOURCE_FLAG_WRITE, 0, &init_value, 0, change_event_cb);
+   }
+   for (map<string, CSV_DATA_INFO>::iterator it = topic_read_info.begin(); it != topic_read_info.end(); it++)
+   {
+      uint32_t quality;
+      (void)memset(&init_value, 0, sizeof(init_value));
+      timestamp64 = 0;
+      if (gettimeofday(&tv, NULL) == 0)
+      {
+         timestamp64 = ((int64_t)((int64_t)tv.tv_sec * 1000000000) + (int64_t)((int64_t)tv.tv_usec * 1000));
+      }
+      quality = get_init_value(it->first.c_str(), &init_value);
+      log("EdgeApp edgedata_data_discover_add (read)...\n");
+      edgedata_data_discover_add(connection, it->first.c_str(), it->second.handle, it->second.type, EDGE_SOURCE_FLAG_READ, quality, &init_value, timestamp64, NULL);
+   }
 }
 
 /******************************************************************************
@@ -644,10 +719,35 @@ void verify_GOTO_value(uint32_t goto_value)
       exit(-1);
    }
 }
+/******************************************************************************
+DESCRIPTION:     Send one event to a SIAPP (called for every connection)
+*****************************************************************************/
+typedef struct
+{
+   uint32_t handle;
+   E_EDGE_DATA_TYPE type;
+   uint32_t quality;
+   T_EDGE_DATA_VALUE value;
+   int64_t timestamp64;
+} SIM_EVENT;
+
+static void send_event_cb(void* fd, void* context)
+{
+   SIM_EVENT* event = (SIM_EVENT*)context;
+   if (!is_discovered(fd))
+   {
+      return;
+   }
+   if (!edgedata_flatbuffers_edge_event_send(fd, event->handle, event->type, event->quality, &event->value, event->timestamp64))
+   {
+      log("Connection aborted\n");
+   }
+}
+
 /******************************************************************************
 DESCRIPTION:     Repeat writing or reading  events by line number
 *****************************************************************************/
-bool Repeat_send_Events_edge(EDGEDATA_IPC_FD* server, uint32_t line_nom)
+bool Repeat_send_Events_edge(EDGEDATA_IPC_SERVER* server, uint32_t line_nom)
 {
    char str_quality[200] = "";
    char str_quality2[200] = "";
@@ -690,6 +790,7 @@ bool Repeat_send_Events_edge(EDGEDATA_IPC_FD* server, uint32_t line_nom)
 
          if (topic_read_info.find(string(topic)) != topic_read_info.end())
          {
+            SIM_EVENT event;
             get_value_edge(row_events["value"].c_str(), topic_read_info[string(topic)].type, &value);
             log("Wait for %d ms\n", wait_ms);
 
@@ -703,41 +804,53 @@ bool Repeat_send_Events_edge(EDGEDATA_IPC_FD* server, uint32_t line_nom)
             (void)get_events_quality_text(quality, str_quality, sizeof(str_quality) - 1);
             log(" Send update for topic: %s, value: %s, quality: %s\n", topic, str_value, str_quality);
 
-            if (!edgedata_flatbuffers_edge_event_send((void*)server, topic_read_info[string(topic)].handle, topic_read_info[string(topic)].type, quality, &value, timestamp64))
+            event.handle = topic_read_info[string(topic)].handle;
+            event.type = topic_read_info[string(topic)].type;
+            event.quality = quality;
+            (void)memcpy(&event.value, &value, sizeof(value));
+            event.timestamp64 = timestamp64;
+            (void)edgedata_ipc_server_broadcast(server, send_event_cb, &event);
+            if (discovered_siapps_count() == 0)
             {
-               log("Connection aborted\n");
+               log("All SIAPPs disconnected\n");
                return false;
             }
          }
 
          if (topic_write_info.find(string(topic)) != topic_write_info.end())
          {
+            CSV_WRITE_DATA_INFO write_info;
             usleep(wait_ms * 1000);
 
-            get_value_edge(row_events["value"].c_str(), topic_write_info[string(topic)].type, &value);
-            get_value_text(&value, topic_write_info[string(topic)].type, str_value, sizeof(str_value) - 1);
-            get_value_text(&topic_write_info[string(topic)].value, topic_write_info[string(topic)].type, str_value2, sizeof(str_value2) - 1);
+            /* copy of the value written by change_event_cb */
+            pthread_mutex_lock(&siapps_mutex);
+            write_info = topic_write_info[string(topic)];
+            pthread_mutex_unlock(&siapps_mutex);
+
+            get_value_edge(row_events["value"].c_str(), write_info.type, &value);
+            get_value_text(&value, write_info.type, str_value, sizeof(str_value) - 1);
+            get_value_text(&write_info.value, write_info.type, str_value2, sizeof(str_value2) - 1);
 
-            if (compare_values(topic_write_info[string(topic)].type, &value, &topic_write_info[string(topic)].value))
+            if (compare_values(write_info.type, &value, &write_info.value))
             {
                log("Value (%s) matches csv file content (expected=%s, current=%s)\n", topic, str_value, str_value2);
             }
             else
             {
-               get_value_text(&value, topic_write_info[string(topic)].type, str_value, sizeof(str_value) - 1);
-               get_value_text(&topic_write_info[string(topic)].value, topic_write_info[string(topic)].type, str_value2, sizeof(str_value2) - 1);
+               get_value_text(&value, write_info.type, str_value, sizeof(str_value) - 1);
+               get_value_text(&write_info.value, write_info.type, str_value2, sizeof(str_value2) - 1);
                log("Value (%s) DOES NOT MATCH csv file content (expected=%s, current=%s) \n", topic, str_value, str_value2);
             }
-            if (topic_write_info[string(topic)].quality == quality)
+            if (write_info.quality == quality)
             {
                get_events_quality_text(quality, str_quality, sizeof(str_quality) - 1);
-               get_events_quality_text(topic_write_info[string(topic)].quality, str_quality2, sizeof(str_quality2) - 1);
+               get_events_quality_text(write_info.quality, str_quality2, sizeof(str_quality2) - 1);
                log("Quality (%s) matches csv file content (expected=%s, current=%s) \n", topic, str_quality, str_quality2);
             }
             else
             {
                (void)get_events_quality_text(quality, str_quality, sizeof(str_quality) - 1);
-               (void)get_events_quality_text(topic_write_info[string(topic)].quality, str_quality2, sizeof(str_quality2) - 1);
+               (void)get_events_quality_text(write_info.quality, str_quality2, sizeof(str_quality2) - 1);
                log("Quality (%s) DOES NOT MATCH csv file content (expected=%s, current=%s) \n", topic, str_quality, str_quality2);
             }
          }
@@ -752,12 +865,50 @@ bool Repeat_send_Events_edge(EDGEDATA_IPC_FD* server, uint32_t line_nom)
 }
 
 
+/******************************************************************************
+DESCRIPTION:     Topics and handles from discover.csv (same for every SIAPP)
+*****************************************************************************/
+void Load_discover_info()
+{
+   uint32_t next_handle = 1;
+
+   log("EdgeApp csv_discover...\n");
+   csvparsing csv_discover(CSV_File1_ptr);
+   map<string, string> row_discover;
+   while (csv_discover >> row_discover)
+   {
+      /* skip empty line? */
+      if (row_discover.size() == 0)
+      {
+         continue;
+      }
+      const char* topic = row_discover["topic"].c_str();
+      uint32_t source = get_source_edge(row_discover["source"].c_str());
+      E_EDGE_DATA_TYPE type = get_type_edge(row_discover["type"].c_str());
+
+      if (source == EDGE_SOURCE_FLAG_WRITE)
+      {
+         CSV_WRITE_DATA_INFO info;
+         info.handle = next_handle;
+         info.type = type;
+         info.quality = 0;
+         (void)memset(&info.value, 0, sizeof(info.value));
+         topic_write_info.insert(std::pair<string, CSV_WRITE_DATA_INFO>(string(topic), info));
+      }
+      else
+      {
+         CSV_DATA_INFO info;
+         info.handle = next_handle;
+         info.type = type;
+         topic_read_info.insert(std::pair<string, CSV_DATA_INFO>(string(topic), info));
+      }
+      next_handle++;
+   }
+}
+
 int main(int argc, char* argv[])
 {
    fstream file1, file2;
-   uint32_t next_handle;
-   struct timeval tv;
-   int64_t timestamp64;
 
    if (argc == 3)
    {
@@ -782,82 +933,24 @@ int main(int argc, char* argv[])
    log("Verify CSV File\n");
    Discover_attribute_control();
    Topic_control_csv_files();
+   Load_discover_info();
 
    log("Start Data Simulation\n");
    edge_data_register_logger(edgedata_print_info);
-   log("Wait for SIAPP to connect...\n");
-   EDGEDATA_IPC_FD* server = edgedata_ipc_unix_server_listen_with_error_cb("/edgedata/edgedata", "root:root", cb_error_connection);
+   /* every SIAPP connected to the socket is served by the server thread */
+   server = edgedata_ipc_unix_server_create("/edgedata/edgedata", "root:root", cb_connected, cb_disconnected);
+   if (server == NULL)
+   {
+      log("Error: server == NULL!");
+      exit(-1);
+   }
+   edgedata_thread_start_server(server);
 
    while (1)
    {
-      topic_read_info.clear();
-      topic_write_info.clear();
-      if (server == NULL)
-      {
-         log("Error: server == NULL!");
-         exit(-1);
-      }
-
-      (void)edgedata_callback_with_reply_register(server, MSG_TYPE_DISCOVER, callback_discover_with_reply);
-      (void)edgedata_callback_with_reply_register(server, MSG_TYPE_UPDATE_DATA, edgedata_flatbuffers_edge_event_receive);
-      (void)edgedata_callback_register(server, MSG_TYPE_UPDATE_DATA, edgedata_rpc_dummy_ack);
-      log("EdgeApp connected to Simulation...\n");
-      next_handle = 1;
-
-      /*
-      DISOVER
-      */
-      log("EdgeApp csv_discover...\n");
-      csvparsing csv_discover(CSV_File1_ptr);
-      map<string, string> row_discover;
-      while (csv_discover >> row_discover)
-      {
-         /* skip empty line? */
-         if (row_discover.size() == 0)
-         {
-            continue;
-         }
-         const char* topic = row_discover["topic"].c_str();
-         uint32_t source = get_source_edge(row_discover["source"].c_str());
-         E_EDGE_DATA_TYPE type = get_type_edge(row_discover["type"].c_str());
-         T_EDGE_DATA_VALUE init_value;
-         (void)memset(&init_value, 0, sizeof(init_value));
-
-         if (source == EDGE_SOURCE_FLAG_WRITE)
-         {
-            CSV_WRITE_DATA_INFO info;
-            info.handle = next_handle;
-            info.type = type;
-            info.quality = 0;
-            (void)memcpy(&info.value, &init_value, sizeof(init_value));
-            topic_write_info.insert(std::pair<string, CSV_WRITE_DATA_INFO>(string(topic), info));
-            log("EdgeApp edgedata_data_discover_add (write)...\n");
-            edgedata_data_discover_add(server, topic, next_handle, type, source, info.quality, &init_value, 0, change_event_cb);
-         }
-         else
-         {
-            CSV_DATA_INFO info;
-            uint32_t quality;
-            info.handle = next_handle;
-            info.type = type;
-            timestamp64 = 0;
-            if (gettimeofday(&tv, NULL) == 0)
-            {
-               timestamp64 = ((int64_t)((int64_t)tv.tv_sec * 1000000000) + (int64_t)((int64_t)tv.tv_usec * 1000));
-            }
-            topic_read_info.insert(std::pair<string, CSV_DATA_INFO>(string(topic), info));
-            quality = get_init_value(topic, &init_value);
-            log("EdgeApp edgedata_data_discover_add (read)...\n");
-            edgedata_data_discover_add(server, topic, next_handle, type, source, quality, &init_value, timestamp64, NULL);
-         }
-         next_handle++;
-      }
-
-      edgedata_thread_start_thread_recv(server);
-      /* start keep alive thread */
-      edgedata_thread_start_keep_alive(server);
+      log("Wait for SIAPP to connect...\n");
       log("Wait for discover\n");
-      while (b_wait_for_discover)
+      while (discovered_siapps_count() == 0)
       {
          usleep(1000);
       }
@@ -873,11 +966,5 @@ int main(int argc, char* argv[])
          log("......................................\n");
          b_connection_ok = Repeat_send_Events_edge(server, goto_number());
       }
-
-      /* reconnect */
-      edgedata_ipc_disconnect(&server);
-      sleep(1);
-      log("Wait for SIAPP to connect...\n");
-      server = edgedata_ipc_unix_server_listen_with_error_cb("/edgedata/edgedata", "root:root", cb_error_connection);
    }
 }